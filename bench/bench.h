@@ -0,0 +1,40 @@
+#ifndef __SIDL_BENCH_H__
+#define __SIDL_BENCH_H__
+
+#include <stddef.h>
+
+#include <strata/handle.h>
+#include <strata/loopback.h>
+#include <strata/status.h>
+#include <strata/uuid.h>
+
+/*
+ * Harness for the call overhead benchmarks emitted with sidlc --bench-src. Each generated file
+ * registers one interface; the harness binds it to a loopback handle and times every case.
+ */
+
+struct BenchCase {
+    const char *function;
+    /* register, packed-calln, out-copy-back or pointer-pass-through */
+    const char *shape;
+    StStatus (*call)(StHandle handle);
+};
+
+struct BenchInterface {
+    const char *name;
+    const struct StUuid *uuid;
+    const struct StLoopbackAbi *abis;
+    size_t abi_count;
+    StLoopbackDispatchFn dispatch;
+    void *server;
+    const struct BenchCase *cases;
+    size_t count;
+    struct BenchInterface *next;
+};
+
+/* Start of the shared region bound to every benchmark handle, for @shared parameters */
+extern void *bench_shared;
+
+void bench_register(struct BenchInterface *iface);
+
+#endif /* __SIDL_BENCH_H__ */
@@ -0,0 +1,258 @@
+#define _GNU_SOURCE
+
+#include <bench.h>
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <strata/loopback.h>
+#include <strata/shm.h>
+
+#define BENCH_DEFAULT_ITERATIONS 1000000
+#define BENCH_WARMUP_ITERATIONS 1000
+#define BENCH_SHARED_SIZE 65536
+
+struct BenchResult {
+    const struct BenchInterface *iface;
+    const struct BenchCase *bcase;
+    StStatus status;
+    double ns_per_call;
+    double instructions_per_call;
+};
+
+static const char *const bench_shapes[] = {
+    "register",
+    "packed-calln",
+    "out-copy-back",
+    "pointer-pass-through",
+};
+
+static struct BenchInterface *bench_interfaces;
+void *bench_shared;
+
+void bench_register(struct BenchInterface *iface)
+{
+    iface->next = bench_interfaces;
+    bench_interfaces = iface;
+}
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Returns -1 when hardware counters are unavailable, e.g. in containers or VMs */
+static int bench_open_instruction_counter(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void bench_run(struct BenchResult *result, StHandle handle, int counter, long iterations)
+{
+    StStatus (*call)(StHandle) = result->bcase->call;
+    uint64_t start, end, instructions = 0;
+    long i;
+
+    result->status = call(handle);
+    if (!CHECK_SUCCESS(result->status)) {
+        return;
+    }
+    for (i = 0; i < BENCH_WARMUP_ITERATIONS; i++) {
+        call(handle);
+    }
+
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    start = bench_now_ns();
+    for (i = 0; i < iterations; i++) {
+        call(handle);
+    }
+    end = bench_now_ns();
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter, &instructions, sizeof(instructions)) != sizeof(instructions)) {
+            instructions = 0;
+        }
+    }
+
+    result->ns_per_call = (double)(end - start) / (double)iterations;
+    result->instructions_per_call = counter >= 0 ? (double)instructions / (double)iterations : -1;
+}
+
+static int bench_compare_interfaces(const void *a, const void *b)
+{
+    const struct BenchInterface *const *ia = a;
+    const struct BenchInterface *const *ib = b;
+
+    return strcmp((*ia)->name, (*ib)->name);
+}
+
+static void bench_print_usage(const char *argv0)
+{
+    fprintf(stderr, "Usage: %s [-n iterations] [filter]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    struct StShmRegion region;
+    struct BenchInterface *iface;
+    struct BenchInterface **ifaces;
+    struct BenchResult *results;
+    const char *filter = NULL;
+    long iterations = BENCH_DEFAULT_ITERATIONS;
+    size_t n_ifaces = 0, n_results = 0, i, j;
+    int counter, opt, failed = 0;
+
+    while ((opt = getopt(argc, argv, "hn:")) != -1) {
+        switch (opt) {
+        case 'n':
+            iterations = strtol(optarg, NULL, 10);
+            if (iterations <= 0) {
+                bench_print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        default:
+            bench_print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind < argc) {
+        filter = argv[optind];
+    }
+
+    for (iface = bench_interfaces; iface != NULL; iface = iface->next) {
+        n_ifaces++;
+        n_results += iface->count;
+    }
+    ifaces = calloc(n_ifaces, sizeof(*ifaces));
+    results = calloc(n_results, sizeof(*results));
+    if ((n_ifaces != 0 && ifaces == NULL) || (n_results != 0 && results == NULL)) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+
+    i = 0;
+    for (iface = bench_interfaces; iface != NULL; iface = iface->next) {
+        ifaces[i++] = iface;
+    }
+    qsort(ifaces, n_ifaces, sizeof(*ifaces), bench_compare_interfaces);
+
+    if (!CHECK_SUCCESS(StShm_Create(&region, BENCH_SHARED_SIZE))) {
+        fprintf(stderr, "Error: Could not create the shared region\n");
+        return 1;
+    }
+    bench_shared = region.base;
+
+    counter = bench_open_instruction_counter();
+
+    n_results = 0;
+    for (i = 0; i < n_ifaces; i++) {
+        StHandle handle;
+
+        if (!CHECK_SUCCESS(StLoopback_Register(ifaces[i]->uuid, ifaces[i]->abis,
+                                               ifaces[i]->abi_count, ifaces[i]->dispatch,
+                                               ifaces[i]->server, &handle)) ||
+            !CHECK_SUCCESS(StShm_Register(handle, &region))) {
+            fprintf(stderr, "Error: Could not register %s\n", ifaces[i]->name);
+            return 1;
+        }
+
+        for (j = 0; j < ifaces[i]->count; j++) {
+            struct BenchResult *result = &results[n_results];
+            char name[256];
+
+            snprintf(name, sizeof(name), "%s.%s", ifaces[i]->name, ifaces[i]->cases[j].function);
+            if (filter != NULL && strstr(name, filter) == NULL) {
+                continue;
+            }
+
+            result->iface = ifaces[i];
+            result->bcase = &ifaces[i]->cases[j];
+            bench_run(result, handle, counter, iterations);
+            n_results++;
+        }
+
+        StShm_Unregister(handle);
+        StLoopback_Unregister(handle);
+    }
+
+    printf("%ld iterations per call, instruction counts %s\n\n", iterations,
+           counter >= 0 ? "from perf_event_open" : "unavailable");
+
+    for (i = 0; i < sizeof(bench_shapes) / sizeof(bench_shapes[0]); i++) {
+        double total_ns = 0, total_instructions = 0;
+        size_t count = 0;
+        int header = 0;
+
+        for (j = 0; j < n_results; j++) {
+            const struct BenchResult *result = &results[j];
+            char name[256];
+
+            if (strcmp(result->bcase->shape, bench_shapes[i]) != 0) {
+                continue;
+            }
+            if (!header) {
+                header = 1;
+                printf("[%s]\n", bench_shapes[i]);
+                printf("  %-48s %10s %12s\n", "function", "ns/call", "instr/call");
+            }
+
+            snprintf(name, sizeof(name), "%s.%s", result->iface->name, result->bcase->function);
+            if (!CHECK_SUCCESS(result->status)) {
+                printf("  %-48s failed with status %d\n", name, result->status);
+                failed = 1;
+                continue;
+            }
+            if (result->instructions_per_call >= 0) {
+                printf("  %-48s %10.2f %12.1f\n", name, result->ns_per_call,
+                       result->instructions_per_call);
+            } else {
+                printf("  %-48s %10.2f %12s\n", name, result->ns_per_call, "-");
+            }
+
+            total_ns += result->ns_per_call;
+            total_instructions += result->instructions_per_call;
+            count++;
+        }
+
+        if (count != 0) {
+            if (counter >= 0) {
+                printf("  %-48s %10.2f %12.1f\n\n", "(mean)", total_ns / (double)count,
+                       total_instructions / (double)count);
+            } else {
+                printf("  %-48s %10.2f %12s\n\n", "(mean)", total_ns / (double)count, "-");
+            }
+        }
+    }
+
+    if (counter >= 0) {
+        close(counter);
+    }
+    StShm_Destroy(&region);
+    free(results);
+    free(ifaces);
+    return failed;
+}
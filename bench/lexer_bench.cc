@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <lexer.hh>
+
+// Lexer throughput over the in-tree interfaces, or the files given on the command line
+
+#define LEXER_BENCH_DEFAULT_BYTES (256u << 20)
+
+static void print_usage(const char *argv0)
+{
+    std::cerr << "Usage: " << argv0 << " [-b bytes] [file.sidl...]\n";
+}
+
+int main(int argc, char **argv)
+{
+    size_t target_bytes = LEXER_BENCH_DEFAULT_BYTES;
+    std::vector<std::string> paths;
+    std::string corpus;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "hb:")) != -1) {
+        switch (opt) {
+        case 'b':
+            target_bytes = std::strtoull(optarg, nullptr, 10);
+            if (target_bytes == 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    for (int i = optind; i < argc; ++i) {
+        paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        for (const auto &entry : std::filesystem::directory_iterator(SIDL_INTERFACE_DIR)) {
+            if (entry.path().extension() == ".sidl") {
+                paths.push_back(entry.path().string());
+            }
+        }
+    }
+
+    // Every file is lexed on its own, so each keeps its line numbers and ends in one EOF token
+    std::vector<std::string> sources;
+    size_t corpus_bytes = 0;
+    for (const auto &path : paths) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open file " << path << std::endl;
+            return 1;
+        }
+        sources.emplace_back(std::istreambuf_iterator<char>(file),
+                             std::istreambuf_iterator<char>());
+        corpus_bytes += sources.back().size();
+    }
+    if (corpus_bytes == 0) {
+        std::cerr << "Error: Nothing to lex" << std::endl;
+        return 1;
+    }
+
+    size_t rounds = (target_bytes + corpus_bytes - 1) / corpus_bytes;
+    size_t tokens = 0;
+    size_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (const auto &source : sources) {
+            Lexer lexer(source);
+            Token token;
+            do {
+                token = lexer.next_token();
+                checksum += token.type + token.text.size();
+                tokens++;
+            } while (token.type != Token::TYPE_ENDOFFILE);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double bytes = static_cast<double>(corpus_bytes) * rounds;
+    std::cout << paths.size() << " files, " << corpus_bytes << " bytes, " << rounds << " rounds\n"
+              << "  " << bytes / elapsed.count() / 1e6 << " MB/s, "
+              << elapsed.count() * 1e9 / tokens << " ns/token (checksum " << checksum << ")\n";
+    return 0;
+}
@@ -25,9 +25,14 @@ function(sidl_generate_c)
 
     set(_generated_srcs)
     set(_generated_hdrs)
+    set(_sidlc_inputs)
+    set(_abs_files)
 
     file(MAKE_DIRECTORY "${arg_HEADER_DIR}")
 
+    # Every file of the call goes through one sidlc process, which compiles them in parallel.
+    # --stable-output leaves unchanged outputs untouched, so the build tool's restat skips
+    # recompiling their dependants.
     foreach(sidl_file ${arg_FILES})
         get_filename_component(abs_file ${sidl_file} ABSOLUTE)
         get_filename_component(basename ${sidl_file} NAME_WE)
@@ -35,24 +40,80 @@ function(sidl_generate_c)
         set(out_hdr "${arg_HEADER_DIR}/${basename}.h")
         set(out_src "${arg_HEADER_DIR}/${basename}.c")
 
-        add_custom_command(
-            OUTPUT ${out_hdr} ${out_src}
-            COMMAND ${SIDLC_EXECUTABLE} 
-                    --lang=c
-                    --arch=${CMAKE_SYSTEM_PROCESSOR}
-                    --header=${out_hdr} 
-                    --user-src=${out_src}
-                    ${abs_file}
-            DEPENDS ${abs_file} ${SIDLC_EXECUTABLE}
-            COMMENT "Compiling SIDL interface: ${basename}.sidl"
-            VERBATIM
-        )
-
-        
+        list(APPEND _sidlc_inputs --header=${out_hdr} --user-src=${out_src} ${abs_file})
+        list(APPEND _abs_files ${abs_file})
         list(APPEND _generated_srcs ${out_src})
         list(APPEND _generated_hdrs ${out_hdr})
     endforeach()
 
+    list(LENGTH arg_FILES _count)
+    add_custom_command(
+        OUTPUT ${_generated_hdrs} ${_generated_srcs}
+        COMMAND ${SIDLC_EXECUTABLE}
+                --lang=c
+                --arch=${CMAKE_SYSTEM_PROCESSOR}
+                -j
+                --stable-output
+                ${_sidlc_inputs}
+        DEPENDS ${_abs_files} ${SIDLC_EXECUTABLE}
+        COMMENT "Compiling ${_count} SIDL interface(s)"
+        VERBATIM
+    )
+
     set(${arg_SRCS_VAR} ${_generated_srcs} PARENT_SCOPE)
     set(${arg_HDRS_VAR} ${_generated_hdrs} PARENT_SCOPE)
 endfunction()
+
+# =========================================================================
+# sidl_generate_cpp
+# Usage: sidl_generate_cpp(HDRS_VAR header_list_out_var_name FILES file1.sidl file2.sidl ...)
+# =========================================================================
+function(sidl_generate_cpp)
+    set(options)
+    set(oneValueArgs HEADER_DIR HDRS_VAR)
+    set(multiValueArgs FILES)
+    cmake_parse_arguments(PARSE_ARGV 0 arg
+        "${options}" "${oneValueArgs}" "${multiValueArgs}"
+    )
+
+    if(NOT arg_FILES)
+        message(FATAL_ERROR "sidl_generate_cpp() called without any SIDL files.")
+    endif()
+
+    if (NOT arg_HEADER_DIR)
+        set(arg_HEADER_DIR "${CMAKE_CURRENT_BINARY_DIR}")
+    endif()
+
+    set(_generated_hdrs)
+    set(_sidlc_inputs)
+    set(_abs_files)
+
+    file(MAKE_DIRECTORY "${arg_HEADER_DIR}")
+
+    foreach(sidl_file ${arg_FILES})
+        get_filename_component(abs_file ${sidl_file} ABSOLUTE)
+        get_filename_component(basename ${sidl_file} NAME_WE)
+
+        set(out_hdr "${arg_HEADER_DIR}/${basename}.hpp")
+
+        list(APPEND _sidlc_inputs --header=${out_hdr} ${abs_file})
+        list(APPEND _abs_files ${abs_file})
+        list(APPEND _generated_hdrs ${out_hdr})
+    endforeach()
+
+    list(LENGTH arg_FILES _count)
+    add_custom_command(
+        OUTPUT ${_generated_hdrs}
+        COMMAND ${SIDLC_EXECUTABLE}
+                --lang=cpp
+                --arch=${CMAKE_SYSTEM_PROCESSOR}
+                -j
+                --stable-output
+                ${_sidlc_inputs}
+        DEPENDS ${_abs_files} ${SIDLC_EXECUTABLE}
+        COMMENT "Compiling ${_count} SIDL interface(s)"
+        VERBATIM
+    )
+
+    set(${arg_HDRS_VAR} ${_generated_hdrs} PARENT_SCOPE)
+endfunction()
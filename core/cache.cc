@@ -0,0 +1,179 @@
+#include <cache.hh>
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <system_error>
+
+#include <mapped_file.hh>
+#include <output_file.hh>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// SHA-256 (FIPS 180-4). The key only has to be collision free, not secret, but a cache that
+// silently hands out another interface's header is worse than no cache.
+class Sha256 {
+    static constexpr std::array<uint32_t, 64> k = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+        0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+        0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+        0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+        0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+        0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+        0xc67178f2,
+    };
+
+    std::array<uint32_t, 8> h = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    std::array<uint8_t, 64> block{};
+    size_t block_used = 0;
+    uint64_t total_bytes = 0;
+
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress()
+    {
+        std::array<uint32_t, 64> w;
+
+        for (size_t i = 0; i < 16; ++i) {
+            w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 |
+                   (uint32_t)block[i * 4 + 2] << 8 | (uint32_t)block[i * 4 + 3];
+        }
+        for (size_t i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        auto [a, b, c, d, e, f, g, hh] = h;
+        for (size_t i = 0; i < 64; ++i) {
+            uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                          k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            hh = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += hh;
+    }
+
+  public:
+    void update(std::string_view data)
+    {
+        total_bytes += data.size();
+        for (char c : data) {
+            block[block_used++] = static_cast<uint8_t>(c);
+            if (block_used == block.size()) {
+                compress();
+                block_used = 0;
+            }
+        }
+    }
+
+    std::string hex_digest()
+    {
+        uint64_t bits = total_bytes * 8;
+        std::string tail(1, '\x80');
+
+        tail.append((block_used < 56 ? 55 : 119) - block_used, '\0');
+        for (int i = 7; i >= 0; --i) {
+            tail.push_back(static_cast<char>(bits >> (i * 8)));
+        }
+        update(tail);
+
+        std::ostringstream os;
+        os << std::hex;
+        for (uint32_t word : h) {
+            os.width(8);
+            os.fill('0');
+            os << word;
+        }
+        return os.str();
+    }
+};
+
+}  // namespace
+
+std::string OutputCache::key(std::string_view source, const std::string &fingerprint) const
+{
+    Sha256 sha;
+
+    // Length-prefixed, so no fingerprint can run into the source and collide with another split
+    sha.update(std::to_string(context.size()) + ":" + context);
+    sha.update(std::to_string(fingerprint.size()) + ":" + fingerprint);
+    sha.update(source);
+    return sha.hex_digest();
+}
+
+bool OutputCache::restore(
+    const std::string &key, const std::vector<LangOutputFile> &files, bool stable
+) const
+{
+    std::error_code ec;
+
+    for (const auto &file : files) {
+        if (!fs::is_regular_file(dir / key / file.kind, ec)) {
+            return false;
+        }
+    }
+    // Written the way generate_output() writes a generated file: unchanged files are only left
+    // alone under --stable-output, otherwise every hit refreshes the output's mtime so it ends up
+    // newer than the input and the build settles
+    for (const auto &file : files) {
+        MappedFile cached;
+
+        if (!cached.open(dir / key / file.kind) ||
+            !(stable ? write_output_if_changed : write_output)(file.path, cached.view())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void OutputCache::store(const std::string &key, const std::vector<LangOutputFile> &files) const
+{
+    std::error_code ec;
+    fs::path entry = dir / key;
+
+    fs::create_directories(entry, ec);
+    if (ec) {
+        return;
+    }
+
+    // Copy under a unique name and rename, so concurrent builds sharing the cache never see a
+    // partial entry
+    std::random_device random;
+    for (const auto &file : files) {
+        fs::path tmp = entry / (file.kind + ".tmp" + std::to_string(random()));
+
+        if (!fs::copy_file(file.path, tmp, ec)) {
+            fs::remove(tmp, ec);
+            continue;
+        }
+        fs::rename(tmp, entry / file.kind, ec);
+        if (ec) {
+            fs::remove(tmp, ec);
+        }
+    }
+}
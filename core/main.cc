@@ -1,13 +1,20 @@
-#include <fstream>
+#include <algorithm>
+#include <atomic>
 #include <iostream>
-#include <iterator>
 #include <map>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <arch_abi.hh>
+#include <cache.hh>
 #include <c_handler.hh>
+#include <cpp_handler.hh>
 #include <lang_info.hh>
+#include <layout.hh>
 #include <lexer.hh>
+#include <mapped_file.hh>
 #include <parser.hh>
 
 #include "config.h"
@@ -31,33 +38,169 @@ static const std::map<std::string, LangInfo> lang_infos = {
                 { "status", { "StStatus", 4, 4 } },
             },
             c_handle_option,
+            c_take_outputs,
             c_generate,
         },
     },
+    {
+        "cpp",
+        {
+            "cpp",
+            {
+                { "opaque", { "void", 0, 0 } },
+                { "u8", { "std::uint8_t", 1, 1 } },
+                { "u16", { "std::uint16_t", 2, 2 } },
+                { "u32", { "std::uint32_t", 4, 4 } },
+                { "u64", { "std::uint64_t", 8, 8 } },
+                { "s8", { "std::int8_t", 1, 1 } },
+                { "s16", { "std::int16_t", 2, 2 } },
+                { "s32", { "std::int32_t", 4, 4 } },
+                { "s64", { "std::int64_t", 8, 8 } },
+                { "handle", { "StHandle", 4, 4 } },
+                { "status", { "StStatus", 4, 4 } },
+            },
+            cpp_handle_option,
+            cpp_take_outputs,
+            cpp_generate,
+        },
+    },
 };
 
 static const std::map<std::string, ArchAbi> arch_abis = {
-    { "x86_64", { "x86_64", 8, 6 } },
+    { "x86_64", { "x86_64", 8, 6, 2 } },
 };
 
 const ArchAbi *g_current_arch_abi = nullptr;
 const LangInfo *g_current_lang_info = nullptr;
 
+struct InputFile {
+    std::string path;
+    std::unique_ptr<LangOutputs> outputs;
+};
+
 void print_usage(const char *argv0)
 {
     std::cerr
-        << "Usage: " << argv0 << " [options] <file>\n"
+        << "Usage: " << argv0 << " [options] [output options] <file> [[output options] <file>...]\n"
         << "Options:\n"
            "  -h, --help    Print this help message\n"
            "  -v, --version Print the version number\n"
+           "  -j[<n>], --jobs=<n>\n"
+           "                Compile up to n input files at once (default 1, -j alone uses\n"
+           "                every hardware thread)\n"
            "  --arch=<arch> Set output architecture\n"
-           "  --lang=<lang> Set output language\n\n"
+           "  --lang=<lang> Set output language\n"
+           "  --cache-dir=<path>\n"
+           "                Reuse outputs generated earlier from the same source, options and\n"
+           "                sidlc build\n"
+           "  --stats       Print source size, AST node count and arena bytes per input file\n\n"
+           "Output options (--header=, --user-src=, ...) apply to the input file that follows\n"
+           "them, or to the only input file when given after it.\n\n"
            "Per-language options:\n"
            "  C: (--lang=c)\n"
            "    --weak                        Make weak symbols\n"
+           "    --funcid-cache                Cache resolved function ID bases per thread\n"
+           "    --batch                       Generate call batching builders\n"
+           "    --reg-returns                 Return scalar out parameters in registers\n"
+           "    --pack-scalars                Pack sub-word scalars into shared register words\n"
+           "    --negotiate                   Generate per-handle abirevision negotiation\n"
+           "    --instrument                  Record per-function call counts, errors and\n"
+           "                                  latency histograms in the client stubs\n"
+           "    --usdt                        Add sys/sdt.h entry and return probes to the\n"
+           "                                  client stubs\n"
+           "    --stable-output               Leave the sidlc version out of the outputs and only\n"
+           "                                  replace files whose contents change\n"
+           "    --inline-stubs                Emit client stubs as static inline in the header\n"
+           "    --inline-arrays=<bytes>       Copy @count/@size payloads up to this size into\n"
+           "                                  the argument block (default 64, 0 disables)\n"
+           "    --layout=<packed|aligned>     Argument block layout, overridden by @layout\n"
            "    --header=<path>               Output header file path (.h)\n"
            "    --user-src=<path>             Output source file path (.c)\n"
-           "    --user-src-header-path=<path> Include path to be written in the generated source\n";
+           "    --user-src-header-path=<path> Include path to be written in the generated source\n"
+           "    --server-src=<path>           Output server dispatcher source file path (.c)\n"
+           "    --bench-src=<path>            Output call overhead benchmark source file path (.c)\n"
+           "  C++: (--lang=cpp)\n"
+           "    --reg-returns                 Same as C, must match the server\n"
+           "    --pack-scalars                Same as C, must match the server\n"
+           "    --layout=<packed|aligned>     Same as C, must match the server\n"
+           "    --inline-arrays=<bytes>       Same as C\n"
+           "    --stable-output               Same as C\n"
+           "    --header=<path>               Output header-only bindings path (.hpp)\n";
+}
+
+static bool parse_jobs(const std::string &value, unsigned &jobs)
+{
+    try {
+        size_t pos;
+        unsigned long n = std::stoul(value, &pos);
+        if (pos != value.size() || n == 0) {
+            return false;
+        }
+        jobs = static_cast<unsigned>(n);
+    } catch (const std::exception &) {
+        return false;
+    }
+    return true;
+}
+
+static bool print_stats = false;
+
+static bool compile(const InputFile &input, const OutputCache *cache)
+{
+    MappedFile file;
+    if (!file.open(input.path)) {
+        std::cerr << "Error: Could not open file " << input.path << std::endl;
+        return false;
+    }
+
+    // The AST's names are views into the mapping, so it outlives every use of the tree
+    std::string_view source = file.view();
+    auto files = input.outputs->files();
+    std::string key;
+
+    if (cache) {
+        key = cache->key(source, input.outputs->fingerprint());
+        if (cache->restore(key, files, input.outputs->stable())) {
+            if (print_stats) {
+                std::cerr << "Stats: " + input.path + ": restored from cache\n";
+            }
+            return true;
+        }
+    }
+
+    AstArena arena;
+    Parser parser(source, arena);
+
+    auto interface = parser.parse();
+
+    if (!interface) {
+        std::cerr << "Error: Failed to compile " << input.path << std::endl;
+        return false;
+    }
+
+    try {
+        LayoutPass layout;
+        interface->accept(layout);
+
+        if (!g_current_lang_info->generate(interface, *input.outputs)) {
+            return false;
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << "Error: " << e.what() << " in " << input.path << std::endl;
+        return false;
+    }
+
+    if (cache) {
+        cache->store(key, files);
+    }
+    if (print_stats) {
+        // One write per line, so lines from parallel jobs do not interleave
+        std::cerr << "Stats: " + input.path + ": " + std::to_string(source.size()) +
+                         " source bytes, " + std::to_string(arena.node_count()) + " AST nodes, " +
+                         std::to_string(arena.bytes_used()) + " arena bytes used of " +
+                         std::to_string(arena.bytes_reserved()) + "\n";
+    }
+    return true;
 }
 
 int main(int argc, char **argv)
@@ -67,9 +210,11 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    std::string input_file_path;
+    std::vector<InputFile> inputs;
     std::string arch;
     std::string lang;
+    std::string cache_dir;
+    unsigned jobs = 1;
 
     // First pass to find the language handler and handle immediate exit flags
     for (int i = 1; i < argc; ++i) {
@@ -105,17 +250,40 @@ int main(int argc, char **argv)
             arch = arg.substr(7);
         } else if (arg.rfind("--lang=", 0) == 0) {
             // Handled in first pass
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            cache_dir = arg.substr(12);
+        } else if (arg == "--stats") {
+            print_stats = true;
+        } else if (arg == "-j") {
+            jobs = std::max(1u, std::thread::hardware_concurrency());
+        } else if (arg.rfind("-j", 0) == 0 || arg.rfind("--jobs=", 0) == 0) {
+            if (!parse_jobs(arg.substr(arg[1] == 'j' ? 2 : 7), jobs)) {
+                std::cerr << "Error: Invalid job count " << arg << '\n';
+                return 1;
+            }
         } else if (arg.rfind("--") == 0) {
             if (!g_current_lang_info->handle_option(arg)) {
                 std::cerr << "Error: Unknown option " << arg << '\n';
                 return 1;
             }
-        } else if (input_file_path.empty()) {
-            input_file_path = arg;
         } else {
-            std::cerr << "Error: Too many input files" << '\n';
+            inputs.push_back({ arg, g_current_lang_info->take_outputs() });
+        }
+    }
+
+    if (inputs.empty()) {
+        std::cerr << "Error: No input files" << '\n';
+        return 1;
+    }
+
+    // Output paths after the last input are only unambiguous for a single input
+    auto trailing = g_current_lang_info->take_outputs();
+    if (!trailing->empty()) {
+        if (inputs.size() != 1 || !inputs[0].outputs->empty()) {
+            std::cerr << "Error: Output options after the last input file" << '\n';
             return 1;
         }
+        inputs[0].outputs = std::move(trailing);
     }
 
     if (arch.empty()) {
@@ -130,20 +298,35 @@ int main(int argc, char **argv)
     }
     g_current_arch_abi = &it->second;
 
-    std::ifstream file(input_file_path);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open file " << input_file_path << std::endl;
-        return 1;
+    std::unique_ptr<OutputCache> cache;
+    if (!cache_dir.empty()) {
+        cache = std::make_unique<OutputCache>(
+            cache_dir, std::string("sidlc ") + SIDLC_VERSION + " " + SIDLC_GIT_HASH + "\nlang=" +
+                           lang + "\narch=" + arch + "\n"
+        );
     }
 
-    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    Parser parser(source);
-
-    auto interface = parser.parse();
+    // Inputs share nothing but the read-only language, architecture and option tables, so each
+    // worker takes the next file until none are left
+    std::atomic<size_t> next_input = 0;
+    std::atomic<bool> failed = false;
+    auto worker = [&]() {
+        for (size_t i; (i = next_input++) < inputs.size();) {
+            if (!compile(inputs[i], cache.get())) {
+                failed = true;
+            }
+        }
+    };
 
-    if (!g_current_lang_info->generate(interface.get())) {
-        return 1;
+    std::vector<std::thread> workers;
+    size_t n_workers = std::min<size_t>(jobs, inputs.size());
+    for (size_t i = 1; i < n_workers; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
     }
 
-    return 0;
+    return failed ? 1 : 0;
 }
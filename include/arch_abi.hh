@@ -7,6 +7,7 @@ struct ArchAbi {
     std::string name;
     size_t pointer_size;
     long max_reg_args;
+    long max_reg_rets;
 };
 
 extern const ArchAbi *g_current_arch_abi;
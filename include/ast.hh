@@ -1,7 +1,15 @@
 #ifndef __AST_HH__
 #define __AST_HH__
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 struct InterfaceNode;
@@ -23,6 +31,61 @@ struct StringLiteralExpressionNode;
 struct NumberLiteralExpressionNode;
 struct IdentifierExpressionNode;
 
+// Children of a node: a span of pointers allocated in the same arena as the nodes
+template <typename T>
+struct NodeList {
+    T *const *items = nullptr;
+    size_t count = 0;
+
+    T *const *begin() const { return items; }
+    T *const *end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T *operator[](size_t i) const { return items[i]; }
+    T *front() const { return items[0]; }
+    T *back() const { return items[count - 1]; }
+};
+
+// Bump allocator owning one interface's AST. Nodes and lists are trivially destructible, so
+// dropping the arena frees the whole tree without walking it.
+class AstArena {
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte *cursor = nullptr;
+    size_t remaining = 0;
+    size_t used = 0;
+    size_t reserved = 0;
+    size_t nodes = 0;
+
+    void *allocate(size_t size, size_t alignment);
+
+  public:
+    static constexpr size_t block_size = 16384;
+
+    template <typename T, typename... Args>
+    T *make(Args &&...args)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arena nodes are never destroyed");
+        nodes++;
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    NodeList<T> list(const std::vector<T *> &items)
+    {
+        if (items.empty()) {
+            return {};
+        }
+
+        auto data = static_cast<T **>(allocate(items.size() * sizeof(T *), alignof(T *)));
+        std::memcpy(data, items.data(), items.size() * sizeof(T *));
+        return { data, items.size() };
+    }
+
+    size_t node_count() const { return nodes; }
+    size_t bytes_used() const { return used; }
+    size_t bytes_reserved() const { return reserved; }
+};
+
 class AstVisitor {
 protected:
     std::string to_c_type(std::string &prefix, TypeNode &node);
@@ -50,18 +113,17 @@ public:
     virtual void visit(IdentifierExpressionNode &node) {};
 };
 
+// Nodes keep their vtable for the visitors, but are never deleted through a base pointer
 struct AstNode {
-    virtual ~AstNode() = default;
     virtual void accept(AstVisitor &visitor) = 0;
-};
 
-struct ExpressionNode : public AstNode {
-    virtual ~ExpressionNode() = default;
+  protected:
+    ~AstNode() = default;
 };
 
-struct LiteralExpressionNode : public ExpressionNode {
-    virtual ~LiteralExpressionNode() = default;
-};
+struct ExpressionNode : public AstNode {};
+
+struct LiteralExpressionNode : public ExpressionNode {};
 
 struct StringLiteralExpressionNode : public LiteralExpressionNode {
     std::string_view value;
@@ -92,7 +154,7 @@ struct IdentifierExpressionNode : public ExpressionNode {
 
 struct AnnotationNode : public AstNode {
     std::string_view name;
-    std::vector<std::unique_ptr<ExpressionNode>> args;
+    NodeList<ExpressionNode> args;
 
     void accept(AstVisitor &visitor) override
     {
@@ -102,12 +164,16 @@ struct AnnotationNode : public AstNode {
 
 struct TypeNode : public AstNode {
     std::string_view name;
-    std::unique_ptr<TypeNode> inner_type;
+    TypeNode *inner_type = nullptr;
     bool is_ptr;
     bool is_array;
     bool is_const;
     size_t type_size;
 
+    // Filled in by the layout pass
+    size_t type_alignment = 0;
+    bool is_struct = false;
+
     void accept(AstVisitor &visitor) override
     {
         visitor.visit(*this);
@@ -122,9 +188,9 @@ struct ParameterNode : public AstNode {
     };
 
     Direction direction;
-    std::unique_ptr<TypeNode> type;
+    TypeNode *type = nullptr;
     std::string_view name;
-    std::vector<std::unique_ptr<AnnotationNode>> annotations;
+    NodeList<AnnotationNode> annotations;
 
     void accept(AstVisitor &visitor) override
     {
@@ -134,8 +200,8 @@ struct ParameterNode : public AstNode {
 
 struct FunctionNode : public AstNode {
     std::string_view name;
-    std::vector<std::unique_ptr<AnnotationNode>> annotations;
-    std::vector<std::unique_ptr<ParameterNode>> parameters;
+    NodeList<AnnotationNode> annotations;
+    NodeList<ParameterNode> parameters;
     AbiversionNode &abiversion;
     uint32_t id;
 
@@ -150,7 +216,7 @@ struct FunctionNode : public AstNode {
 struct EnumMemberNode : public AstNode {
     std::string_view name;
     uint64_t value;
-    std::vector<std::unique_ptr<AnnotationNode>> annotations;
+    NodeList<AnnotationNode> annotations;
 
     void accept(AstVisitor &visitor) override
     {
@@ -160,9 +226,9 @@ struct EnumMemberNode : public AstNode {
 
 struct EnumNode : public AstNode {
     std::string_view name;
-    std::unique_ptr<TypeNode> base_type;
-    std::vector<std::unique_ptr<AnnotationNode>> annotations;
-    std::vector<std::unique_ptr<EnumMemberNode>> members;
+    TypeNode *base_type = nullptr;
+    NodeList<AnnotationNode> annotations;
+    NodeList<EnumMemberNode> members;
     AbiversionNode &abiversion;
 
     EnumNode(AbiversionNode &abiversion) : abiversion(abiversion) {}
@@ -174,8 +240,9 @@ struct EnumNode : public AstNode {
 };
 
 struct StructFieldNode : public AstNode {
-    std::unique_ptr<TypeNode> type;
+    TypeNode *type = nullptr;
     std::string_view name;
+    size_t offset = 0;
 
     void accept(AstVisitor &visitor) override
     {
@@ -185,9 +252,11 @@ struct StructFieldNode : public AstNode {
 
 struct StructNode : public AstNode {
     std::string_view name;
-    std::vector<std::unique_ptr<AnnotationNode>> annotations;
-    std::vector<std::unique_ptr<StructFieldNode>> fields;
+    NodeList<AnnotationNode> annotations;
+    NodeList<StructFieldNode> fields;
     AbiversionNode &abiversion;
+    size_t size = 0;
+    size_t alignment = 0;
 
     StructNode(AbiversionNode &abiversion) : abiversion(abiversion) {}
 
@@ -209,9 +278,9 @@ struct BitfieldFieldNode : public AstNode {
 
 struct BitfieldNode : public AstNode {
     std::string_view name;
-    std::unique_ptr<TypeNode> base_type;
-    std::vector<std::unique_ptr<AnnotationNode>> annotations;
-    std::vector<std::unique_ptr<BitfieldFieldNode>> fields;
+    TypeNode *base_type = nullptr;
+    NodeList<AnnotationNode> annotations;
+    NodeList<BitfieldFieldNode> fields;
     AbiversionNode &abiversion;
 
     BitfieldNode(AbiversionNode &abiversion) : abiversion(abiversion) {}
@@ -224,11 +293,11 @@ struct BitfieldNode : public AstNode {
 
 struct AbiversionNode : public AstNode {
     uint64_t version;
-    std::vector<std::unique_ptr<AnnotationNode>> annotations;
-    std::vector<std::unique_ptr<FunctionNode>> functions;
-    std::vector<std::unique_ptr<StructNode>> structs;
-    std::vector<std::unique_ptr<BitfieldNode>> bitfields;
-    std::vector<std::unique_ptr<EnumNode>> enums;
+    NodeList<AnnotationNode> annotations;
+    NodeList<FunctionNode> functions;
+    NodeList<StructNode> structs;
+    NodeList<BitfieldNode> bitfields;
+    NodeList<EnumNode> enums;
     GroupNode &group;
 
     AbiversionNode(GroupNode &group) : group(group) {}
@@ -241,8 +310,8 @@ struct AbiversionNode : public AstNode {
 
 struct GroupNode : public AstNode {
     std::string_view name;
-    std::vector<std::unique_ptr<AnnotationNode>> annotations;
-    std::vector<std::unique_ptr<AbiversionNode>> abiversions;
+    NodeList<AnnotationNode> annotations;
+    NodeList<AbiversionNode> abiversions;
     InterfaceNode &interface;
     uint32_t id;
     uint32_t current_funcid;
@@ -257,8 +326,8 @@ struct GroupNode : public AstNode {
 
 struct InterfaceNode : public AstNode {
     std::string_view name;
-    std::vector<std::unique_ptr<AnnotationNode>> annotations;
-    std::vector<std::unique_ptr<GroupNode>> groups;
+    NodeList<AnnotationNode> annotations;
+    NodeList<GroupNode> groups;
     uint32_t current_groupid;
 
     InterfaceNode() : current_groupid(0) {}
@@ -0,0 +1,39 @@
+#ifndef __C_BENCH_GENERATOR_HH__
+#define __C_BENCH_GENERATOR_HH__
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <ast.hh>
+#include <c_generator_base.hh>
+#include <c_options.hh>
+
+// Emits a call overhead benchmark for every function of the interface: a server with empty
+// handlers plus one caller per function, registered with the bench/ harness at load time.
+class CBenchGenerator : public CGeneratorBase {
+    std::ostream &out;
+    std::string header_name;
+    std::stringstream buf_handlers;
+    std::stringstream buf_callers;
+    std::stringstream buf_ops;
+    std::stringstream buf_cases;
+    std::stringstream buf_abis;
+    std::string group_name;
+    std::string macro_group_name;
+
+    std::string shape_name(const CallShape &shape);
+
+  public:
+    CBenchGenerator(std::ostream &out, const std::string &header_name, const COptions &options)
+        : CGeneratorBase(options), out(out), header_name(header_name)
+    {
+    }
+
+    void visit(InterfaceNode &node) override;
+    void visit(GroupNode &node) override;
+    void visit(AbiversionNode &node) override;
+    void visit(FunctionNode &node) override;
+};
+
+#endif  // __C_BENCH_GENERATOR_HH__
@@ -0,0 +1,141 @@
+#ifndef __C_GENERATOR_BASE_HH__
+#define __C_GENERATOR_BASE_HH__
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <ast.hh>
+#include <c_options.hh>
+
+// Shared by the C header, client source and server source generators so that every output agrees
+// on how a function's arguments are laid out on the wire.
+class CGeneratorBase : public AstVisitor {
+  protected:
+    struct RegField {
+        ParameterNode *param;
+        size_t shift;
+        size_t bits;
+    };
+
+    struct BlockField {
+        ParameterNode *param;
+        size_t offset;
+    };
+
+    struct BlockLayout {
+        std::vector<BlockField> fields;
+        size_t size;
+        size_t alignment;
+    };
+
+    struct CallShape {
+        bool use_call_reg;
+        // Inline payloads make the in block variable-sized, so StHandle_CallNS passes its size
+        // in place of the last peeled scalar
+        bool sized_in;
+        size_t k_peel;
+        // Every argument on the register path, only the peeled scalars otherwise
+        std::vector<std::vector<RegField>> reg_words;
+        std::vector<ParameterNode *> packed_in_params;
+        std::vector<ParameterNode *> packed_out_params;
+        // Out scalars handed back through StHandle_CallR<N>, only on the register path
+        std::vector<ParameterNode *> reg_out_params;
+    };
+
+    std::string prefix;
+    std::string macro_interface_name;
+    const COptions &options;
+    CBlockLayout layout;
+    bool has_shared = false;
+    bool has_inline_arrays = false;
+
+    CGeneratorBase(const COptions &options) : options(options), layout(options.layout) {}
+
+    void parse_interface_annotations(InterfaceNode &node);
+    // Name-based UUID derived from @uuid, empty when the interface has none
+    std::vector<uint8_t> interface_uuid(InterfaceNode &node);
+    bool has_annotation(
+        const NodeList<AnnotationNode> &annotations, std::string_view name
+    );
+
+    std::string param_decl(ParameterNode &param, const std::string &name);
+    std::string value_decl(TypeNode &type, const std::string &name);
+    std::string funcid_macro(FunctionNode &node);
+    size_t scalar_size(TypeNode &type);
+    bool place_reg_field(ParameterNode &param, size_t max_words, CallShape &shape);
+    bool is_reg_return(ParameterNode &param);
+    CallShape classify(FunctionNode &node);
+    std::string reg_word_value(const std::vector<RegField> &word);
+    BlockLayout block_layout(std::vector<ParameterNode *> params);
+    bool find_reg_field(
+        const CallShape &shape, ParameterNode *param, size_t &word, size_t &shift
+    );
+
+    // @shared pointers travel as a u64 offset into the region registered for the handle, which
+    // has to hold their whole extent: their length, or a single pointee without one
+    bool is_shared(ParameterNode &param);
+    std::string shared_extent(FunctionNode &node, ParameterNode &param, const std::string &len);
+    bool wire_is_ptr(ParameterNode &param);
+    std::string wire_decl(ParameterNode &param, const std::string &name);
+    std::string wire_value(ParameterNode &param);
+
+    // Banner attribution, without the version under --stable-output
+    std::string generated_by();
+
+    // Stubs are emitted into the user source, or as static inline functions in the header with
+    // --inline-stubs, in which case every file-scope helper name is prefixed to stay unique
+    std::string stub_name(const std::string &name);
+    void emit_params(std::ostream &os, FunctionNode &node);
+    void emit_query(std::ostream &os, FunctionNode &node, const std::string &indent = "    ");
+    void emit_shared_decls(std::ostream &os, FunctionNode &node);
+    void emit_shared_offsets(std::ostream &os, FunctionNode &node);
+    // A NULL pointer marks a payload copied into the block, so it may not have a length
+    void emit_length_checks(std::ostream &os, FunctionNode &node);
+    // A negotiated stub takes its handle and funcid base from the client instead of querying
+    void emit_stub(
+        std::ostream &os, FunctionNode &node, const CallShape &shape, bool negotiated = false
+    );
+    void emit_stub_signature(
+        std::ostream &os, FunctionNode &node, bool negotiated, const std::string &name
+    );
+    void emit_stub_body(
+        std::ostream &os, FunctionNode &node, const CallShape &shape, bool negotiated
+    );
+
+    // --instrument: every stub records into a per-thread slot indexed by its <IF>_STATS_* macro
+    std::string stats_macro(FunctionNode &node);
+    void emit_stats_now(std::ostream &os);
+    // --usdt: sidl_<interface>:call_entry(group, abirevision, funcid) and call_return(..., status)
+    std::string usdt_provider();
+    // --funcid-cache: direct-mapped per-thread entries, each slot with its own invalidation epoch
+    static constexpr size_t funcid_cache_size = 8;
+    // Handles a batch keeps resolved bases for, per (group, abirevision)
+    static constexpr size_t batch_handles = 4;
+    void emit_funcid_cache_entry(std::ostream &os);
+    void emit_funcid_cache_query(std::ostream &os);
+
+    // @count(n)/@size(n) tie an in const pointer to the in scalar holding its length in elements
+    // or bytes. Both always travel in the in block, and synchronous stubs copy short payloads in
+    // right behind it, passing a NULL pointer in their place; @shared payloads are never copied.
+    // The server only accepts payloads within the in size handed to StHandle_CallNS.
+    AnnotationNode *length_annotation(ParameterNode &param);
+    ParameterNode *length_param(FunctionNode &node, ParameterNode &param);
+    bool is_length_param(FunctionNode &node, ParameterNode &param);
+    bool is_inline_array(ParameterNode &param);
+    bool has_inline_payloads(FunctionNode &node);
+    std::string length_bytes(ParameterNode &param, const std::string &ptr, const std::string &len);
+    std::string length_fits(
+        ParameterNode &param, const std::string &ptr, const std::string &len,
+        const std::string &max
+    );
+
+    bool is_async(FunctionNode &node);
+    std::string async_in_member(FunctionNode &node, const CallShape &shape);
+    // Rings resolve one funcid base per abirevision with @async functions, in visiting order
+    std::vector<AbiversionNode *> ring_abis;
+    size_t ring_base(FunctionNode &node);
+};
+
+#endif  // __C_GENERATOR_BASE_HH__
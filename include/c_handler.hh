@@ -1,11 +1,15 @@
 #ifndef __C_HANDLER_HH__
 #define __C_HANDLER_HH__
 
+#include <memory>
 #include <string>
 
+#include <lang_info.hh>
+
 struct InterfaceNode;
 
 bool c_handle_option(const std::string &arg);
-bool c_generate(InterfaceNode *interface);
+std::unique_ptr<LangOutputs> c_take_outputs();
+bool c_generate(InterfaceNode *interface, const LangOutputs &outputs);
 
 #endif  // __C_HANDLER_HH__
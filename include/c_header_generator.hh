@@ -4,20 +4,49 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <ast.hh>
+#include <c_generator_base.hh>
+#include <c_options.hh>
 
-class CHeaderGenerator : public AstVisitor {
+class CHeaderGenerator : public CGeneratorBase {
     std::ostream &out;
-    std::string prefix;
     std::string macro_prefix;
-    std::string macro_interface_name;
     std::stringstream buf_macros;
     std::stringstream buf_types;
+    std::stringstream buf_bitfields;
+    std::stringstream buf_blocks;
+    std::stringstream buf_asserts;
     std::stringstream buf_functions;
+    std::stringstream buf_batch;
+    std::stringstream buf_server_ops;
+    std::stringstream buf_server_functions;
+    std::stringstream buf_ring_members;
+    std::stringstream buf_ring_functions;
+    std::stringstream buf_stub_cache;
+    std::stringstream buf_negotiate_ops;
+    std::stringstream buf_negotiate_groups;
+    std::stringstream buf_negotiate_functions;
+    bool has_async = false;
+    size_t n_stats = 0;
+    size_t n_batch_bases = 0;
+
+    void emit_arg_block(
+        FunctionNode &node, const std::string &suffix, std::vector<ParameterNode *> params
+    );
+    void emit_arg_blocks(FunctionNode &node, const CallShape &shape);
+    void emit_layout_assert(const std::string &expr, size_t value, const std::string &what);
+    // Typed per-field accessors, whole-value pack/unpack, and SIMD scans over arrays of values
+    std::string bitfield_field_type(uint64_t bits);
+    void emit_bitfield_accessors(BitfieldNode &node);
+    void emit_bitfield_bulk(BitfieldNode &node);
 
   public:
-    CHeaderGenerator(std::ostream &out) : out(out) {}
+    CHeaderGenerator(std::ostream &out, const COptions &options)
+        : CGeneratorBase(options), out(out)
+    {
+    }
 
     void visit(InterfaceNode &node) override;
     void visit(GroupNode &node) override;
@@ -0,0 +1,35 @@
+#ifndef __C_OPTIONS_HH__
+#define __C_OPTIONS_HH__
+
+#include <cstddef>
+#include <string>
+
+enum class CBlockLayout {
+    PACKED,
+    ALIGNED,
+};
+
+struct COptions {
+    bool make_weak_symbols = false;
+    bool funcid_cache = false;
+    bool batch = false;
+    bool pack_scalars = false;
+    bool reg_returns = false;
+    bool inline_stubs = false;
+    bool negotiate = false;
+    bool instrument = false;
+    bool usdt = false;
+    // Leave the sidlc version out of the outputs and only replace files whose bytes change
+    bool stable_output = false;
+    // Largest @count/@size payload copied into the in block, a multiple of 8
+    size_t inline_array_max = 64;
+    CBlockLayout layout = CBlockLayout::PACKED;
+};
+
+// Sets inline_array_max from the value of --inline-arrays=, false when it is not a number
+bool parse_inline_arrays(const std::string &value, COptions &options);
+
+// Every field above in a fixed order, for the cache key of the outputs they shape
+std::string options_fingerprint(const COptions &options);
+
+#endif  // __C_OPTIONS_HH__
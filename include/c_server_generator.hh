@@ -0,0 +1,32 @@
+#ifndef __C_SERVER_GENERATOR_HH__
+#define __C_SERVER_GENERATOR_HH__
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <ast.hh>
+#include <c_generator_base.hh>
+#include <c_options.hh>
+
+class CServerGenerator : public CGeneratorBase {
+    std::ostream &out;
+    std::string header_name;
+    std::stringstream buf_decoders;
+    std::stringstream buf_tables;
+    std::stringstream buf_dispatch;
+
+    std::string cast_type(ParameterNode &param);
+
+  public:
+    CServerGenerator(std::ostream &out, const std::string &header_name, const COptions &options)
+        : CGeneratorBase(options), out(out), header_name(header_name)
+    {
+    }
+
+    void visit(InterfaceNode &node) override;
+    void visit(GroupNode &node) override;
+    void visit(FunctionNode &node) override;
+};
+
+#endif  // __C_SERVER_GENERATOR_HH__
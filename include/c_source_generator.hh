@@ -6,19 +6,32 @@
 #include <string>
 
 #include <ast.hh>
+#include <c_generator_base.hh>
+#include <c_options.hh>
 
-class CSourceGenerator : public AstVisitor {
+class CSourceGenerator : public CGeneratorBase {
     std::ostream &out;
-    std::string prefix;
-    std::string macro_interface_name;
     std::string header_name;
-    std::stringstream buf_macros;
+    std::stringstream buf_cache;
     std::stringstream buf_functions;
-    bool make_weak_symbols;
+    std::stringstream buf_batch;
+    std::stringstream buf_ring;
+    std::stringstream buf_negotiate;
+    std::stringstream buf_negotiate_body;
+    std::stringstream buf_stats_names;
+    bool has_async = false;
+    // Batches cache one funcid base per (group, abirevision) with functions, in visiting order
+    size_t n_batch_bases = 0;
+
+    void emit_batch(FunctionNode &node, const CallShape &shape);
+    void emit_submit(FunctionNode &node, const CallShape &shape);
+    void emit_unsupported(FunctionNode &node);
+    void emit_negotiate_tables(GroupNode &node);
+    void emit_instrumentation();
 
   public:
-    CSourceGenerator(std::ostream &out, const std::string &header_name, bool make_weak_symbols)
-        : out(out), header_name(header_name), make_weak_symbols(make_weak_symbols)
+    CSourceGenerator(std::ostream &out, const std::string &header_name, const COptions &options)
+        : CGeneratorBase(options), out(out), header_name(header_name)
     {
     }
 
@@ -0,0 +1,34 @@
+#ifndef __CACHE_HH__
+#define __CACHE_HH__
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <lang_info.hh>
+
+// Content-addressed store of generated files. An entry is keyed on everything its bytes depend on
+// (source, language, architecture, options and the sidlc build), so a hit can be copied to the
+// output paths without lexing, parsing or generating anything.
+class OutputCache {
+    std::filesystem::path dir;
+    // sidlc build, language and architecture, shared by every input of the invocation
+    std::string context;
+
+  public:
+    OutputCache(std::filesystem::path dir, std::string context)
+        : dir(std::move(dir)), context(std::move(context))
+    {
+    }
+
+    std::string key(std::string_view source, const std::string &fingerprint) const;
+
+    // Both are best effort: a miss or a failed store only means the file is generated again
+    bool restore(
+        const std::string &key, const std::vector<LangOutputFile> &files, bool stable
+    ) const;
+    void store(const std::string &key, const std::vector<LangOutputFile> &files) const;
+};
+
+#endif  // __CACHE_HH__
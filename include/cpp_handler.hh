@@ -0,0 +1,15 @@
+#ifndef __CPP_HANDLER_HH__
+#define __CPP_HANDLER_HH__
+
+#include <memory>
+#include <string>
+
+#include <lang_info.hh>
+
+struct InterfaceNode;
+
+bool cpp_handle_option(const std::string &arg);
+std::unique_ptr<LangOutputs> cpp_take_outputs();
+bool cpp_generate(InterfaceNode *interface, const LangOutputs &outputs);
+
+#endif  // __CPP_HANDLER_HH__
@@ -0,0 +1,53 @@
+#ifndef __CPP_HEADER_GENERATOR_HH__
+#define __CPP_HEADER_GENERATOR_HH__
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ast.hh>
+#include <c_generator_base.hh>
+#include <c_options.hh>
+
+// Emits header-only C++20 bindings. Calls are classified exactly like the C stubs, so a C++
+// client talks to servers generated by the C backend; everything that is known at generation
+// time (IDs, UUID, block layouts, call shapes) ends up as constexpr data or a template
+// specialisation instead of runtime code.
+class CppHeaderGenerator : public CGeneratorBase {
+    std::ostream &out;
+    std::string namespace_name;
+    std::stringstream buf_types;
+    std::stringstream buf_functions;
+    std::stringstream buf_blocks;
+    std::stringstream buf_marshal;
+    std::stringstream buf_handles;
+    std::stringstream buf_ring_members;
+    std::vector<FunctionNode *> group_functions;
+    bool has_async = false;
+
+    std::string word_value(const std::vector<RegField> &word);
+    void emit_arg_block(
+        FunctionNode &node, const std::string &suffix, std::vector<ParameterNode *> params
+    );
+    void emit_length_checks(FunctionNode &node);
+    void emit_marshal(FunctionNode &node, const CallShape &shape);
+    void emit_submit(FunctionNode &node, const CallShape &shape);
+    void emit_handle(GroupNode &group, AbiversionNode &abi);
+
+  public:
+    CppHeaderGenerator(std::ostream &out, const COptions &options)
+        : CGeneratorBase(options), out(out)
+    {
+    }
+
+    void visit(InterfaceNode &node) override;
+    void visit(GroupNode &node) override;
+    void visit(AbiversionNode &node) override;
+    void visit(StructNode &node) override;
+    void visit(BitfieldNode &node) override;
+    void visit(EnumNode &node) override;
+    void visit(FunctionNode &node) override;
+};
+
+#endif  // __CPP_HEADER_GENERATOR_HH__
@@ -2,7 +2,9 @@
 #define __LANG_INFO_HH__
 
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 struct LangTypeInfo {
     std::string lang_name;
@@ -12,11 +14,30 @@ struct LangTypeInfo {
 
 struct InterfaceNode;
 
+struct LangOutputFile {
+    // Stable name of the output within the backend, e.g. "header"
+    std::string kind;
+    std::string path;
+};
+
+// Output paths of one input file, owned by the language backend that parsed them
+struct LangOutputs {
+    virtual ~LangOutputs() = default;
+    virtual bool empty() const = 0;
+    virtual std::vector<LangOutputFile> files() const = 0;
+    // Everything besides the source, language and architecture that the output bytes depend on
+    virtual std::string fingerprint() const = 0;
+    // Outputs are only replaced when their bytes change (--stable-output)
+    virtual bool stable() const = 0;
+};
+
 struct LangInfo {
     std::string name;
     std::map<std::string, LangTypeInfo> type_infos;
     bool (*handle_option)(const std::string &arg);
-    bool (*generate)(InterfaceNode *interface);
+    // Hands over the output paths given since the previous input file
+    std::unique_ptr<LangOutputs> (*take_outputs)();
+    bool (*generate)(InterfaceNode *interface, const LangOutputs &outputs);
 };
 
 extern const LangInfo *g_current_lang_info;
@@ -0,0 +1,31 @@
+#ifndef __LAYOUT_HH__
+#define __LAYOUT_HH__
+
+#include <map>
+#include <set>
+#include <string_view>
+
+#include <ast.hh>
+
+// Resolves every type in the interface against the current language and architecture, filling in
+// TypeNode sizes/alignments and struct field offsets for the generators.
+class LayoutPass : public AstVisitor {
+    std::map<std::string_view, StructNode *> structs;
+    std::map<std::string_view, TypeNode *> aliases;
+    std::set<StructNode *> in_progress;
+
+    void layout_type(TypeNode &type);
+    void layout_struct(StructNode &node);
+    // Checks @count/@size and turns array<> parameters into const pointers
+    void check_length(FunctionNode &node, ParameterNode &param);
+
+  public:
+    void visit(InterfaceNode &node) override;
+    void visit(AbiversionNode &node) override;
+    void visit(StructNode &node) override;
+    void visit(BitfieldNode &node) override;
+    void visit(EnumNode &node) override;
+    void visit(FunctionNode &node) override;
+};
+
+#endif  // __LAYOUT_HH__
@@ -1,6 +1,8 @@
 #ifndef __LEXER_HH__
 #define __LEXER_HH__
 
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 
 struct Token {
@@ -28,9 +30,11 @@ struct Token {
     };
 
     Type type;
+    // Numbers carry their digits without the 0x/0b/0 prefix, to be decoded in this radix
     std::string_view text;
     size_t line;
     size_t start_column;
+    int radix = 10;
 };
 
 class Lexer {
@@ -42,6 +46,10 @@ class Lexer {
 
     void skip_unmeaningful_string();
     void advance();
+    // Moves to new_pos, accounting for any newlines in between
+    void advance_to(size_t new_pos);
+    size_t scan_while(size_t from, uint8_t char_class) const;
+    Token number_token(size_t start, int radix, uint8_t char_class, size_t start_column);
 
   public:
     Lexer(std::string_view source) : source(source), pos(0), current_line(1), current_column(1) {}
@@ -0,0 +1,25 @@
+#ifndef __MAPPED_FILE_HH__
+#define __MAPPED_FILE_HH__
+
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file. Regular files are mapped, so the lexer works on the page cache
+// directly; pipes and devices, which cannot be mapped, are read into a private buffer instead.
+class MappedFile {
+    void *mapping = nullptr;
+    size_t mapping_size = 0;
+    std::string buffer;
+    std::string_view contents;
+
+  public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    bool open(const std::string &path);
+    std::string_view view() const { return contents; }
+};
+
+#endif  // __MAPPED_FILE_HH__
@@ -0,0 +1,40 @@
+#ifndef __OUTPUT_FILE_HH__
+#define __OUTPUT_FILE_HH__
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include <ast.hh>
+
+// Replaces path with content in a single write to a temporary file in the same directory and a
+// rename, so readers, including parallel builds racing on the same output, see either the old or
+// the new file and never a partial one
+bool write_output(const std::string &path, std::string_view content);
+
+// Same, but a file that already holds exactly these bytes is left alone, mtime included, so its
+// dependants are not rebuilt
+bool write_output_if_changed(const std::string &path, std::string_view content);
+
+// Runs Generator(stream, args...) over the interface into memory and writes the result to path,
+// only on change when stable
+template <typename Generator, typename... Args>
+bool generate_output(InterfaceNode *interface, const std::string &path, bool stable, Args &&...args)
+{
+    if (path.empty()) {
+        return true;
+    }
+
+    std::ostringstream buffer;
+    Generator generator(buffer, std::forward<Args>(args)...);
+    interface->accept(generator);
+
+    if (!(stable ? write_output_if_changed : write_output)(path, buffer.view())) {
+        std::cerr << "Error: Could not write file " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif  // __OUTPUT_FILE_HH__
@@ -8,27 +8,30 @@ class Parser {
   private:
     Lexer lexer;
     Token current_token;
+    AstArena &arena;
 
     void advance();
     void expect(Token::Type token_type);
     void consume(Token::Type token_type);
+    uint64_t parse_number();
 
-    std::unique_ptr<IdentifierExpressionNode> parse_identifier_expression();
-    std::unique_ptr<LiteralExpressionNode> parse_literal_expression();
-    std::unique_ptr<AnnotationNode> parse_annotation();
-    std::unique_ptr<GroupNode> parse_group(InterfaceNode &interface);
-    std::unique_ptr<AbiversionNode> parse_abiversion(GroupNode &group);
-    std::unique_ptr<FunctionNode> parse_function(AbiversionNode &abiversion);
-    std::unique_ptr<StructNode> parse_struct(AbiversionNode &abiversion);
-    std::unique_ptr<BitfieldNode> parse_bitfield(AbiversionNode &abiversion);
-    std::unique_ptr<EnumNode> parse_enum(AbiversionNode &abiversion);
-    std::unique_ptr<TypeNode> parse_type();
-    std::unique_ptr<ParameterNode> parse_parameter();
+    IdentifierExpressionNode *parse_identifier_expression();
+    LiteralExpressionNode *parse_literal_expression();
+    AnnotationNode *parse_annotation();
+    GroupNode *parse_group(InterfaceNode &interface);
+    AbiversionNode *parse_abiversion(GroupNode &group);
+    FunctionNode *parse_function(AbiversionNode &abiversion);
+    StructNode *parse_struct(AbiversionNode &abiversion);
+    BitfieldNode *parse_bitfield(AbiversionNode &abiversion);
+    EnumNode *parse_enum(AbiversionNode &abiversion);
+    TypeNode *parse_type();
+    ParameterNode *parse_parameter();
 
   public:
-    Parser(std::string_view source) : lexer(source) {}
+    Parser(std::string_view source, AstArena &arena) : lexer(source), arena(arena) {}
 
-    std::unique_ptr<InterfaceNode> parse();
+    // The returned tree lives in the arena; nullptr after a syntax error
+    InterfaceNode *parse();
 };
 
 #endif  // __PARSER_HH__
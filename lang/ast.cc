@@ -1,6 +1,34 @@
 #include <ast.hh>
 #include <lang_info.hh>
 
+void *AstArena::allocate(size_t size, size_t alignment)
+{
+    size_t padding = -reinterpret_cast<uintptr_t>(cursor) & (alignment - 1);
+
+    if (padding + size > remaining) {
+        // Oversized requests get a block of their own and the current one stays active, so its
+        // remaining bytes are not wasted
+        if (size > block_size) {
+            blocks.push_back(std::make_unique<std::byte[]>(size));
+            reserved += size;
+            used += size;
+            return blocks.back().get();
+        }
+
+        blocks.push_back(std::make_unique<std::byte[]>(block_size));
+        cursor = blocks.back().get();
+        remaining = block_size;
+        reserved += block_size;
+        padding = 0;
+    }
+
+    void *ptr = cursor + padding;
+    cursor += padding + size;
+    remaining -= padding + size;
+    used += padding + size;
+    return ptr;
+}
+
 std::string AstVisitor::to_c_type(std::string &prefix, TypeNode &node)
 {
     std::string str;
@@ -0,0 +1,154 @@
+#include <c_bench_generator.hh>
+
+#include <algorithm>
+
+#include <ast.hh>
+
+void CBenchGenerator::visit(InterfaceNode &node)
+{
+    parse_interface_annotations(node);
+
+    for (const auto &group : node.groups) {
+        group->accept(*this);
+    }
+
+    out << "/* =====================================================================\n";
+    out << " * Auto-generated by " << generated_by() << "\n";
+    out << " * Target Interface: " << node.name << "\n";
+    out << " * DO NOT EDIT THIS FILE MANUALLY!\n";
+    out << " * ===================================================================== */\n\n";
+
+    out << "#include \"" << header_name << "\"\n\n";
+    out << "#include <stddef.h>\n";
+    out << "#include <stdint.h>\n";
+    out << "#include <string.h>\n\n";
+    out << "#include <strata/status.h>\n";
+    out << "#include <strata/macros.h>\n";
+    out << "#include <strata/loopback.h>\n\n";
+    out << "#include <bench.h>\n\n";
+
+    if (buf_cases.tellp() == 0) {
+        return;
+    }
+
+    out << "/* Handlers */\n";
+    out << buf_handlers.str();
+
+    out << "static const struct " << prefix << "ServerOps bench_ops = {\n";
+    out << buf_ops.str();
+    out << "};\n\n";
+    out << "static struct " << prefix << "Server bench_server = { &bench_ops, NULL };\n\n";
+
+    out << "/* Callers */\n";
+    out << buf_callers.str();
+
+    out << "static const struct StUuid bench_uuid = UUID_" << macro_interface_name
+        << "_INTERFACE_INIT;\n\n";
+    // Every revision the generated dispatcher has a table for, so queries for anything else fail
+    out << "static const struct StLoopbackAbi bench_abis[] = {\n";
+    out << buf_abis.str();
+    out << "};\n\n";
+    out << "static const struct BenchCase bench_cases[] = {\n";
+    out << buf_cases.str();
+    out << "};\n\n";
+
+    // Registered before main() so the harness only has to be linked with the generated sources
+    out << "__attribute__((constructor)) static void bench_register_" << prefix << "(void)\n";
+    out << "{\n";
+    out << "    static struct BenchInterface iface = {\n";
+    out << "        .name = \"" << node.name << "\",\n";
+    out << "        .uuid = &bench_uuid,\n";
+    out << "        .abis = bench_abis,\n";
+    out << "        .abi_count = sizeof(bench_abis) / sizeof(bench_abis[0]),\n";
+    out << "        .dispatch = " << prefix << "Dispatch,\n";
+    out << "        .server = &bench_server,\n";
+    out << "        .cases = bench_cases,\n";
+    out << "        .count = sizeof(bench_cases) / sizeof(bench_cases[0]),\n";
+    out << "    };\n";
+    out << "    bench_register(&iface);\n";
+    out << "}\n";
+}
+
+void CBenchGenerator::visit(GroupNode &node)
+{
+    group_name = node.name;
+    macro_group_name = group_name;
+    std::transform(
+        macro_group_name.begin(),
+        macro_group_name.end(),
+        macro_group_name.begin(),
+        ::toupper
+    );
+    for (const auto &abi : node.abiversions) {
+        abi->accept(*this);
+    }
+}
+
+void CBenchGenerator::visit(AbiversionNode &node)
+{
+    if (!node.functions.empty()) {
+        buf_abis << "    { " << macro_interface_name << "_GROUP_" << macro_group_name << ", "
+                 << node.version << " },\n";
+    }
+    for (const auto &f : node.functions) {
+        f->accept(*this);
+    }
+}
+
+std::string CBenchGenerator::shape_name(const CallShape &shape)
+{
+    if (shape.use_call_reg) {
+        return "register";
+    }
+
+    for (const auto &param : shape.packed_out_params) {
+        if (shape.packed_out_params.size() > 1 || !param->type->is_ptr) {
+            return "out-copy-back";
+        }
+    }
+
+    if (shape.packed_in_params.size() > 1 ||
+        (shape.packed_in_params.size() == 1 && !wire_is_ptr(*shape.packed_in_params.front()))) {
+        return "packed-calln";
+    }
+    return "pointer-pass-through";
+}
+
+void CBenchGenerator::visit(FunctionNode &node)
+{
+    CallShape shape = classify(node);
+
+    buf_handlers << "static StStatus bench_handle_" << node.name << "(void *ctx";
+    for (const auto &param : node.parameters) {
+        buf_handlers << ", " << param_decl(*param, std::string(param->name));
+    }
+    buf_handlers << ")\n";
+    buf_handlers << "{\n";
+    buf_handlers << "    return STATUS_SUCCESS;\n";
+    buf_handlers << "}\n\n";
+
+    buf_ops << "    ." << node.name << " = bench_handle_" << node.name << ",\n";
+
+    // Arguments are zeroed; @shared pointers have to point into the region bound to the handle
+    buf_callers << "static StStatus bench_call_" << node.name << "(StHandle handle)\n";
+    buf_callers << "{\n";
+    for (const auto &param : node.parameters) {
+        buf_callers << "    " << value_decl(*param->type, std::string(param->name)) << ";\n";
+    }
+    for (const auto &param : node.parameters) {
+        buf_callers << "    memset(&" << param->name << ", 0, sizeof(" << param->name << "));\n";
+        if (is_shared(*param)) {
+            buf_callers << "    " << param->name << " = bench_shared;\n";
+        }
+    }
+    buf_callers << "    return " << prefix << node.name << "(handle";
+    for (const auto &param : node.parameters) {
+        buf_callers << ", " << (param->direction == ParameterNode::Direction::IN ? "" : "&")
+                    << param->name;
+    }
+    buf_callers << ");\n";
+    buf_callers << "}\n\n";
+
+    buf_cases << "    { \"" << group_name << "." << node.name << "\", \"" << shape_name(shape)
+              << "\", bench_call_" << node.name << " },\n";
+}
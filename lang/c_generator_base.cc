@@ -0,0 +1,883 @@
+#include <c_generator_base.hh>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <uuid.h>
+
+#include <arch_abi.hh>
+#include <ast.hh>
+
+#include "config.h"
+
+void CGeneratorBase::parse_interface_annotations(InterfaceNode &node)
+{
+    macro_interface_name = node.name;
+    std::transform(
+        macro_interface_name.begin(),
+        macro_interface_name.end(),
+        macro_interface_name.begin(),
+        ::toupper
+    );
+
+    for (const auto &anno : node.annotations) {
+        if (anno->name == "prefix") {
+            if (anno->args.size() != 1) {
+                throw std::runtime_error("Invalid argument size");
+            }
+
+            auto prefix_param = dynamic_cast<StringLiteralExpressionNode *>(anno->args[0]);
+            if (!prefix_param) {
+                throw std::runtime_error("Invalid argument type");
+            }
+
+            prefix = prefix_param->value.substr(1, prefix_param->value.size() - 2);
+        } else if (anno->name == "layout") {
+            if (anno->args.size() != 1) {
+                throw std::runtime_error("Invalid argument size");
+            }
+
+            auto layout_param = dynamic_cast<IdentifierExpressionNode *>(anno->args[0]);
+            if (!layout_param) {
+                throw std::runtime_error("Invalid argument type");
+            }
+
+            if (layout_param->name == "packed") {
+                layout = CBlockLayout::PACKED;
+            } else if (layout_param->name == "aligned") {
+                layout = CBlockLayout::ALIGNED;
+            } else {
+                throw std::runtime_error("Unknown layout " + std::string(layout_param->name));
+            }
+        }
+    }
+}
+
+std::vector<uint8_t> CGeneratorBase::interface_uuid(InterfaceNode &node)
+{
+    std::vector<uint8_t> bytes;
+
+    for (const auto &anno : node.annotations) {
+        if (anno->name == "uuid") {
+            if (anno->args.size() != 2) {
+                throw std::runtime_error("Invalid argument size");
+            }
+
+            auto namespace_param = dynamic_cast<StringLiteralExpressionNode *>(anno->args[0]);
+            if (!namespace_param) {
+                throw std::runtime_error("Invalid argument type");
+            }
+
+            std::string_view namespace_str =
+                namespace_param->value.substr(1, namespace_param->value.size() - 2);
+
+            if (!uuids::uuid::is_valid_uuid(namespace_str)) {
+                throw std::runtime_error("Invalid UUID");
+            }
+
+            auto uuid = uuids::uuid::from_string(namespace_str);
+            if (!uuid) {
+                throw std::runtime_error("Invalid UUID");
+            }
+
+            auto name_param = dynamic_cast<StringLiteralExpressionNode *>(anno->args[1]);
+            if (!name_param) {
+                throw std::runtime_error("Invalid argument type");
+            }
+
+            std::string_view name_str = name_param->value.substr(1, name_param->value.size() - 2);
+
+            uuids::uuid_name_generator gen(uuid.value());
+            auto final_uuid = gen(name_str);
+
+            bytes.clear();
+            for (const auto &byte : final_uuid.as_bytes()) {
+                bytes.push_back(static_cast<uint8_t>(byte));
+            }
+        }
+    }
+
+    return bytes;
+}
+
+bool CGeneratorBase::has_annotation(
+    const NodeList<AnnotationNode> &annotations, std::string_view name
+)
+{
+    for (const auto &anno : annotations) {
+        if (anno->name == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string CGeneratorBase::param_decl(ParameterNode &param, const std::string &name)
+{
+    bool add_pointer = param.direction != ParameterNode::Direction::IN;
+
+    if (param.type->is_ptr) {
+        return to_c_type(prefix, *param.type) + (add_pointer ? "*" : "") + name;
+    }
+    return to_c_type(prefix, *param.type) + (add_pointer ? " *" : " ") + name;
+}
+
+std::string CGeneratorBase::value_decl(TypeNode &type, const std::string &name)
+{
+    if (type.is_ptr) {
+        return to_c_type(prefix, type) + name;
+    }
+    return to_c_type(prefix, type) + " " + name;
+}
+
+std::string CGeneratorBase::funcid_macro(FunctionNode &node)
+{
+    std::string macro_name(node.name);
+    std::transform(macro_name.begin(), macro_name.end(), macro_name.begin(), ::toupper);
+
+    return macro_interface_name + "_FUNCID_" + macro_name;
+}
+
+size_t CGeneratorBase::scalar_size(TypeNode &type)
+{
+    if (type.is_struct || type.is_array) {
+        return 0;
+    }
+    return type.type_size;
+}
+
+bool CGeneratorBase::place_reg_field(ParameterNode &param, size_t max_words, CallShape &shape)
+{
+    size_t word_bits = g_current_arch_abi->pointer_size * 8;
+    size_t bits = is_shared(param) ? 64 : scalar_size(*param.type) * 8;
+
+    // Without packing, or for anything that is not a sub-word scalar, the field owns its word
+    if (!options.pack_scalars || bits == 0 || bits >= word_bits) {
+        bits = word_bits;
+    } else {
+        for (auto &word : shape.reg_words) {
+            const auto &last = word.back();
+            size_t shift = (last.shift + last.bits + bits - 1) / bits * bits;
+
+            if (shift + bits <= word_bits) {
+                word.push_back({ &param, shift, bits });
+                return true;
+            }
+        }
+    }
+
+    if (shape.reg_words.size() >= max_words) {
+        return false;
+    }
+    shape.reg_words.push_back({ { &param, 0, bits } });
+    return true;
+}
+
+bool CGeneratorBase::is_reg_return(ParameterNode &param)
+{
+    return options.reg_returns && param.direction == ParameterNode::Direction::OUT &&
+           !param.type->is_array && !param.type->is_struct &&
+           param.type->type_size <= g_current_arch_abi->pointer_size;
+}
+
+CGeneratorBase::CallShape CGeneratorBase::classify(FunctionNode &node)
+{
+    CallShape shape;
+    size_t k_base = 2;
+    size_t n_avail = g_current_arch_abi->max_reg_args - k_base;
+
+    shape.use_call_reg = true;
+    shape.sized_in = false;
+    shape.k_peel = n_avail > 2 ? n_avail - 2 : 0;
+
+    // Completions only carry a status, so @async functions keep their results in the out block
+    size_t n_rets = 0;
+    if (options.reg_returns && !has_annotation(node.annotations, "async")) {
+        for (const auto &param : node.parameters) {
+            if (is_reg_return(*param)) {
+                n_rets++;
+            }
+        }
+    }
+    // The rets pointer takes up one argument register
+    if (n_rets > 0 && n_rets <= (size_t)g_current_arch_abi->max_reg_rets) {
+        n_avail--;
+    } else {
+        n_rets = 0;
+    }
+
+    // Lengths stay in the in block, next to the payload they describe
+    std::vector<bool> is_scalar;
+    for (const auto &param : node.parameters) {
+        is_scalar.push_back(
+            is_shared(*param) ||
+            (param->direction == ParameterNode::Direction::IN && !is_length_param(node, *param) &&
+             !param->type->is_ptr && !param->type->is_array && !param->type->is_struct &&
+             param->type->type_size <= g_current_arch_abi->pointer_size)
+        );
+
+        if (n_rets > 0 && is_reg_return(*param)) {
+            shape.reg_out_params.push_back(param);
+        } else if (!is_scalar.back() || !place_reg_field(*param, n_avail, shape)) {
+            shape.use_call_reg = false;
+        }
+    }
+
+    if (shape.use_call_reg) {
+        return shape;
+    }
+
+    shape.reg_words.clear();
+    shape.reg_out_params.clear();
+    shape.sized_in = has_inline_payloads(node);
+    if (shape.sized_in && shape.k_peel > 0) {
+        shape.k_peel--;
+    }
+    for (size_t i = 0; i < node.parameters.size(); ++i) {
+        auto param = node.parameters[i];
+
+        if (param->direction == ParameterNode::Direction::OUT) {
+            shape.packed_out_params.push_back(param);
+        } else if (!is_scalar[i] || !place_reg_field(*param, shape.k_peel, shape)) {
+            shape.packed_in_params.push_back(param);
+        }
+    }
+
+    return shape;
+}
+
+std::string CGeneratorBase::reg_word_value(const std::vector<RegField> &word)
+{
+    if (word.size() == 1 && word.front().shift == 0) {
+        return "(unsigned long)" + wire_value(*word.front().param);
+    }
+
+    // Go through the unsigned type of the field's width so sign extension cannot leak into the
+    // neighbouring fields
+    std::string value;
+    for (const auto &field : word) {
+        std::string part =
+            "(unsigned long)(uint" + std::to_string(field.bits) + "_t)" + wire_value(*field.param);
+
+        if (!value.empty()) {
+            value += " | ";
+        }
+        value += field.shift == 0 ? part : "(" + part + " << " + std::to_string(field.shift) + ")";
+    }
+    return "(" + value + ")";
+}
+
+CGeneratorBase::BlockLayout CGeneratorBase::block_layout(std::vector<ParameterNode *> params)
+{
+    auto field_size = [this](ParameterNode *param) -> size_t {
+        return is_shared(*param) ? 8 : param->type->type_size;
+    };
+    auto field_alignment = [this](ParameterNode *param) -> size_t {
+        if (layout == CBlockLayout::PACKED) {
+            return 1;
+        }
+        return is_shared(*param) ? 8 : param->type->type_alignment;
+    };
+
+    // Fields are only accessed by name, so the aligned layout is free to reorder them; sorting by
+    // decreasing alignment leaves no interior padding.
+    if (layout == CBlockLayout::ALIGNED) {
+        std::stable_sort(params.begin(), params.end(), [&](auto a, auto b) {
+            return field_alignment(a) > field_alignment(b);
+        });
+    }
+
+    BlockLayout block;
+    size_t offset = 0;
+
+    block.alignment = 1;
+    for (const auto &param : params) {
+        offset = (offset + field_alignment(param) - 1) / field_alignment(param) *
+            field_alignment(param);
+        block.fields.push_back({ param, offset });
+        offset += field_size(param);
+        block.alignment = std::max(block.alignment, field_alignment(param));
+    }
+    block.size = (offset + block.alignment - 1) / block.alignment * block.alignment;
+
+    return block;
+}
+
+bool CGeneratorBase::find_reg_field(
+    const CallShape &shape, ParameterNode *param, size_t &word, size_t &shift
+)
+{
+    for (size_t i = 0; i < shape.reg_words.size(); ++i) {
+        for (const auto &field : shape.reg_words[i]) {
+            if (field.param == param) {
+                word = i;
+                shift = field.shift;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CGeneratorBase::is_shared(ParameterNode &param)
+{
+    if (!has_annotation(param.annotations, "shared")) {
+        return false;
+    }
+
+    if (!param.type->is_ptr || param.direction != ParameterNode::Direction::IN) {
+        throw std::runtime_error(
+            "@shared parameter " + std::string(param.name) + " must be an in ptr<>"
+        );
+    }
+
+    has_shared = true;
+    return true;
+}
+
+bool CGeneratorBase::wire_is_ptr(ParameterNode &param)
+{
+    return param.type->is_ptr && !is_shared(param);
+}
+
+std::string CGeneratorBase::wire_decl(ParameterNode &param, const std::string &name)
+{
+    if (is_shared(param)) {
+        return "uint64_t " + name;
+    }
+    return param_decl(param, name);
+}
+
+std::string CGeneratorBase::wire_value(ParameterNode &param)
+{
+    if (is_shared(param)) {
+        return "_" + std::string(param.name) + "_offset";
+    }
+    return "_" + std::string(param.name);
+}
+
+std::string CGeneratorBase::stub_name(const std::string &name)
+{
+    return options.inline_stubs ? prefix + name : name;
+}
+
+void CGeneratorBase::emit_query(std::ostream &os, FunctionNode &node, const std::string &indent)
+{
+    uint32_t group_id = node.abiversion.group.id;
+    uint64_t version = node.abiversion.version;
+
+    if (options.funcid_cache) {
+        os << indent << "status = " << stub_name("query_funcid_base") << "("
+           << stub_name("funcid_cache_") << group_id << "_" << version << ", handle, " << group_id
+           << ", " << version << ", &funcid_base);\n";
+    } else {
+        os << indent << "status = StHandle_Query(handle, &" << stub_name("interface_uuid") << ", "
+           << group_id << ", " << version << ", &funcid_base, NULL);\n";
+    }
+    os << indent << "if (!CHECK_SUCCESS(status)) { return status; }\n";
+}
+
+void CGeneratorBase::emit_shared_decls(std::ostream &os, FunctionNode &node)
+{
+    for (const auto &param : node.parameters) {
+        if (is_shared(*param)) {
+            os << "    uint64_t " << wire_value(*param) << ";\n";
+        }
+    }
+}
+
+void CGeneratorBase::emit_shared_offsets(std::ostream &os, FunctionNode &node)
+{
+    // Only the offset crosses the boundary; the payload already sits in the shared region.
+    for (const auto &param : node.parameters) {
+        if (is_shared(*param)) {
+            auto length = length_param(node, *param);
+            std::string len = length ? "_" + std::string(length->name) : "";
+
+            os << "    status = StShm_ToOffset(handle, _" << param->name << ", "
+               << shared_extent(node, *param, len) << ", &" << wire_value(*param) << ");\n";
+            os << "    if (!CHECK_SUCCESS(status)) { return status; }\n";
+        }
+    }
+}
+
+void CGeneratorBase::emit_length_checks(std::ostream &os, FunctionNode &node)
+{
+    for (const auto &param : node.parameters) {
+        if (auto length = length_param(node, *param)) {
+            os << "    if (_" << param->name << " == NULL && _" << length->name
+               << " != 0) { return STATUS_INVALID_ARGUMENT; }\n";
+        }
+    }
+}
+
+void CGeneratorBase::emit_params(std::ostream &os, FunctionNode &node)
+{
+    for (const auto &param : node.parameters) {
+        os << ", " << param_decl(*param, "_" + std::string(param->name));
+
+        switch (param->direction) {
+        case ParameterNode::Direction::IN:
+            os << " __in";
+            break;
+        case ParameterNode::Direction::OUT:
+            os << " __out";
+            break;
+        case ParameterNode::Direction::INOUT:
+            os << " __inout";
+            break;
+        }
+    }
+}
+
+std::string CGeneratorBase::stats_macro(FunctionNode &node)
+{
+    std::string macro_name(node.name);
+    std::transform(macro_name.begin(), macro_name.end(), macro_name.begin(), ::toupper);
+
+    return macro_interface_name + "_STATS_" + macro_name;
+}
+
+std::string CGeneratorBase::generated_by()
+{
+    if (options.stable_output) {
+        return "sidlc";
+    }
+    return std::string("sidlc v") + SIDLC_VERSION + " (" + SIDLC_GIT_HASH + ")";
+}
+
+std::string CGeneratorBase::usdt_provider()
+{
+    std::string provider = "sidl_" + macro_interface_name;
+    std::transform(provider.begin(), provider.end(), provider.begin(), ::tolower);
+
+    return provider;
+}
+
+void CGeneratorBase::emit_stats_now(std::ostream &os)
+{
+    // CLOCK_MONOTONIC never steps backwards, unlike the wall clock, so a latency is never
+    // negative; it is read through the vDSO without entering the kernel
+    os << "static inline uint64_t " << stub_name("stats_now") << "(void)\n";
+    os << "{\n";
+    os << "    struct timespec ts;\n";
+    os << "    clock_gettime(CLOCK_MONOTONIC, &ts);\n";
+    os << "    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;\n";
+    os << "}\n\n";
+}
+
+void CGeneratorBase::emit_stub(
+    std::ostream &os, FunctionNode &node, const CallShape &shape, bool negotiated
+)
+{
+    std::string name = negotiated ? "negotiated_" + std::string(node.name) : "";
+
+    if (!options.instrument && !options.usdt) {
+        emit_stub_signature(os, node, negotiated, name);
+        emit_stub_body(os, node, shape, negotiated);
+        return;
+    }
+
+    // The wrapped body keeps its early returns; the wrapper sees whatever it returned
+    std::string wrapped = stub_name("wrapped_" + std::string(negotiated ? name : node.name));
+    std::string probe_args = std::to_string(node.abiversion.group.id) + ", " +
+        std::to_string(node.abiversion.version) + ", " + funcid_macro(node);
+
+    os << "static inline StStatus " << wrapped << "("
+       << (negotiated ? "const struct " + prefix + "Client *client __in" : "StHandle handle __in");
+    emit_params(os, node);
+    os << ")\n";
+    emit_stub_body(os, node, shape, negotiated);
+
+    emit_stub_signature(os, node, negotiated, name);
+    os << "{\n";
+    os << "    StStatus status;\n";
+    if (options.instrument) {
+        os << "    uint64_t start = " << stub_name("stats_now") << "();\n";
+    }
+    if (options.usdt) {
+        os << "    DTRACE_PROBE3(" << usdt_provider() << ", call_entry, " << probe_args << ");\n";
+    }
+    os << "    status = " << wrapped << "(" << (negotiated ? "client" : "handle");
+    for (const auto &param : node.parameters) {
+        os << ", _" << param->name;
+    }
+    os << ");\n";
+    if (options.instrument) {
+        os << "    " << prefix << "RecordStats(" << stats_macro(node) << ", status, start);\n";
+    }
+    if (options.usdt) {
+        os << "    DTRACE_PROBE4(" << usdt_provider() << ", call_return, " << probe_args
+           << ", status);\n";
+    }
+    os << "    return status;\n";
+    os << "}\n\n";
+}
+
+void CGeneratorBase::emit_stub_signature(
+    std::ostream &os, FunctionNode &node, bool negotiated, const std::string &name
+)
+{
+    if (negotiated) {
+        os << "static StStatus " << name << "(const struct " << prefix << "Client *client __in";
+    } else {
+        if (options.inline_stubs) {
+            os << "static inline ";
+        } else if (options.make_weak_symbols) {
+            os << "__attribute__((weak))\n";
+        }
+        os << "StStatus " << prefix << node.name << "(StHandle handle __in";
+    }
+    emit_params(os, node);
+    os << ")\n";
+}
+
+void CGeneratorBase::emit_stub_body(
+    std::ostream &os, FunctionNode &node, const CallShape &shape, bool negotiated
+)
+{
+    const auto &packed_in_params = shape.packed_in_params;
+    const auto &packed_out_params = shape.packed_out_params;
+
+    os << "{\n";
+    os << "    StStatus status;\n";
+    if (negotiated) {
+        os << "    StHandle handle = client->handle;\n";
+        os << "    uint32_t funcid_base = client->" << node.abiversion.group.name
+           << ".funcid_base;\n";
+    } else {
+        os << "    uint32_t funcid_base;\n";
+    }
+
+    // Short payloads are copied into the words right behind the block, one slot per array
+    size_t n_inline = 0;
+    if (!shape.use_call_reg && options.inline_array_max != 0) {
+        for (const auto &param : node.parameters) {
+            if (is_inline_array(*param)) {
+                n_inline++;
+            }
+        }
+    }
+    std::string in = n_inline != 0 ? "block.in" : "in";
+
+    // The payload words are left uninitialized; only the bytes actually copied are sent
+    if (n_inline != 0) {
+        has_inline_arrays = true;
+        os << "    struct {\n";
+        os << "        struct " << prefix << node.name << "_In in;\n";
+        os << "        uint64_t payload[" << n_inline * options.inline_array_max / 8 << "];\n";
+        os << "    } block;\n";
+    } else if (!shape.use_call_reg && packed_in_params.size() > 1) {
+        os << "    struct " << prefix << node.name << "_In in = {\n";
+        for (const auto &param : packed_in_params) {
+            if (!is_shared(*param)) {
+                os << "        ." << param->name << " = _" << param->name << ",\n";
+            }
+        }
+        os << "    };\n";
+    }
+    if (n_inline != 0) {
+        os << "    size_t payload_size = 0;\n";
+    }
+    emit_shared_decls(os, node);
+    if (!shape.reg_out_params.empty()) {
+        os << "    unsigned long rets[" << shape.reg_out_params.size() << "];\n";
+    }
+    if (!shape.use_call_reg && !packed_out_params.empty()) {
+        if (packed_out_params.size() > 1) {
+            os << "    struct " << prefix << node.name << "_Out out;\n";
+        } else if (!packed_out_params.front()->type->is_ptr) {
+            os << "    " << to_c_type(prefix, *packed_out_params.front()->type) << " out;\n";
+        }
+    }
+    emit_length_checks(os, node);
+    if (!negotiated) {
+        emit_query(os, node);
+    }
+    emit_shared_offsets(os, node);
+    if (!shape.use_call_reg && packed_in_params.size() > 1) {
+        for (const auto &param : packed_in_params) {
+            if (n_inline != 0 || is_shared(*param)) {
+                os << "    " << in << "." << param->name << " = " << wire_value(*param) << ";\n";
+            }
+        }
+    }
+    for (const auto &param : node.parameters) {
+        auto length = length_param(node, *param);
+        if (n_inline == 0 || !is_inline_array(*param)) {
+            continue;
+        }
+
+        std::string ptr = "_" + std::string(param->name);
+        std::string len = "_" + std::string(length->name);
+        std::string dest =
+            n_inline > 1 ? "(uint8_t *)block.payload + payload_size" : "block.payload";
+
+        os << "    if (" << len << " != 0 && "
+           << length_fits(*param, ptr, len, std::to_string(options.inline_array_max)) << ") {\n";
+        os << "        memcpy(" << dest << ", " << ptr << ", " << length_bytes(*param, ptr, len)
+           << ");\n";
+        os << "        block.in." << param->name << " = NULL;\n";
+        os << "        payload_size += (" << length_bytes(*param, ptr, len) << " + 7) / 8 * 8;\n";
+        os << "    }\n";
+    }
+
+    if (shape.use_call_reg && !shape.reg_out_params.empty()) {
+        os << "    status = StHandle_CallR" << shape.reg_words.size() << "(handle, funcid_base + "
+           << funcid_macro(node) << ", rets";
+        for (const auto &word : shape.reg_words) {
+            os << ", " << reg_word_value(word);
+        }
+        os << ");\n";
+    } else if (shape.use_call_reg) {
+        os << "    status = StHandle_Call" << shape.reg_words.size() << "(handle, funcid_base + "
+           << funcid_macro(node);
+        for (const auto &word : shape.reg_words) {
+            os << ", " << reg_word_value(word);
+        }
+        os << ");\n";
+    } else {
+        os << "    status = StHandle_CallN" << (shape.sized_in ? "S" : "")
+           << "(handle, funcid_base + " << funcid_macro(node) << ", ";
+        // The server only reads payload words that lie within the size passed along
+        if (shape.sized_in) {
+            os << "(const void *)&" << in << ", ";
+            if (n_inline != 0) {
+                os << "(sizeof(block.in) + 7) / 8 * 8 + payload_size, ";
+            } else {
+                os << "sizeof(in), ";
+            }
+        } else if (!packed_in_params.empty()) {
+            if (packed_in_params.size() == 1) {
+                if (wire_is_ptr(*packed_in_params.front())) {
+                    os << "(const void *)_" << packed_in_params.front()->name << ", ";
+                } else {
+                    os << "(const void *)&" << wire_value(*packed_in_params.front()) << ", ";
+                }
+            } else {
+                os << "(const void *)&" << in << ", ";
+            }
+        } else {
+            os << "NULL, ";
+        }
+        if (!packed_out_params.empty()) {
+            if (packed_out_params.size() == 1) {
+                if (packed_out_params.front()->type->is_ptr) {
+                    os << "(void *)_" << packed_out_params.front()->name << ", ";
+                } else {
+                    os << "(void *)&out, ";
+                }
+            } else {
+                os << "(void *)&out, ";
+            }
+        } else {
+            os << "NULL, ";
+        }
+        for (size_t i = 0; i < shape.k_peel; ++i) {
+            if (i < shape.reg_words.size()) {
+                os << reg_word_value(shape.reg_words[i]);
+            } else {
+                os << "0";
+            }
+            if (i < shape.k_peel - 1) {
+                os << ", ";
+            }
+        }
+        os << ");\n";
+    }
+    os << "    if (!CHECK_SUCCESS(status)) { return status; }\n";
+
+    for (size_t i = 0; i < shape.reg_out_params.size(); ++i) {
+        auto param = shape.reg_out_params[i];
+        os << "    if (_" << param->name << " != NULL) "
+           << "{ *_" << param->name << " = (" << to_c_type(prefix, *param->type) << ")rets[" << i
+           << "]; }\n";
+    }
+    if (!shape.use_call_reg && !packed_out_params.empty()) {
+        if (packed_out_params.size() == 1) {
+            auto param = packed_out_params.front();
+            if (!param->type->is_ptr) {
+                os << "    if (_" << param->name << " != NULL) "
+                   << "{ *_" << param->name << " = out; }\n";
+            }
+        } else {
+            for (const auto &param : packed_out_params) {
+                os << "    if (_" << param->name << " != NULL) "
+                   << "{ *_" << param->name << " = out." << param->name << "; }\n";
+            }
+        }
+    }
+
+    os << "    return STATUS_SUCCESS;\n";
+    os << "}\n\n";
+}
+
+void CGeneratorBase::emit_funcid_cache_query(std::ostream &os)
+{
+    std::string entry = "struct " + stub_name("FuncidCacheEntry");
+
+    os << "static inline StStatus " << stub_name("query_funcid_base") << "(" << entry
+       << " *cache, StHandle handle, uint32_t group, uint64_t version, uint32_t *funcid_base)\n";
+    os << "{\n";
+    os << "    unsigned long slot = (unsigned long)handle % " << stub_name("FUNCID_CACHE_SIZE")
+       << ";\n";
+    os << "    uint32_t epoch = atomic_load_explicit(&" << stub_name("funcid_cache_epoch")
+       << "[slot], memory_order_acquire);\n";
+    os << "    " << entry << " *entry = &cache[slot];\n";
+    os << "    StStatus status;\n";
+    os << "    if (entry->epoch == epoch && entry->handle == handle) {\n";
+    os << "        *funcid_base = entry->funcid_base;\n";
+    os << "        return STATUS_SUCCESS;\n";
+    os << "    }\n";
+    os << "    status = StHandle_Query(handle, &" << stub_name("interface_uuid")
+       << ", group, version, funcid_base, NULL);\n";
+    os << "    if (!CHECK_SUCCESS(status)) { return status; }\n";
+    os << "    entry->handle = handle;\n";
+    os << "    entry->funcid_base = *funcid_base;\n";
+    os << "    entry->epoch = epoch;\n";
+    os << "    return STATUS_SUCCESS;\n";
+    os << "}\n\n";
+}
+
+void CGeneratorBase::emit_funcid_cache_entry(std::ostream &os)
+{
+    os << "#define " << stub_name("FUNCID_CACHE_SIZE") << " " << funcid_cache_size << "\n\n";
+    os << "struct " << stub_name("FuncidCacheEntry") << " {\n";
+    os << "    StHandle handle;\n";
+    os << "    uint32_t funcid_base;\n";
+    os << "    uint32_t epoch;\n";
+    os << "};\n\n";
+}
+
+AnnotationNode *CGeneratorBase::length_annotation(ParameterNode &param)
+{
+    for (const auto &anno : param.annotations) {
+        if (anno->name == "count" || anno->name == "size") {
+            return anno;
+        }
+    }
+    return nullptr;
+}
+
+ParameterNode *CGeneratorBase::length_param(FunctionNode &node, ParameterNode &param)
+{
+    auto anno = length_annotation(param);
+    if (!anno) {
+        return nullptr;
+    }
+
+    // Checked by the layout pass
+    auto name = static_cast<IdentifierExpressionNode *>(anno->args[0])->name;
+    for (const auto &other : node.parameters) {
+        if (other->name == name) {
+            return other;
+        }
+    }
+    return nullptr;
+}
+
+bool CGeneratorBase::is_length_param(FunctionNode &node, ParameterNode &param)
+{
+    for (const auto &other : node.parameters) {
+        if (length_param(node, *other) == &param) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CGeneratorBase::is_inline_array(ParameterNode &param)
+{
+    return length_annotation(param) && !is_shared(param);
+}
+
+bool CGeneratorBase::has_inline_payloads(FunctionNode &node)
+{
+    for (const auto &param : node.parameters) {
+        if (is_inline_array(*param)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string CGeneratorBase::shared_extent(
+    FunctionNode &node, ParameterNode &param, const std::string &len
+)
+{
+    std::string size = "sizeof(" + to_c_type(prefix, *param.type->inner_type) + ")";
+
+    if (!length_param(node, param)) {
+        return "1, " + size;
+    }
+    return length_annotation(param)->name == "size" ? len + ", 1" : len + ", " + size;
+}
+
+std::string CGeneratorBase::length_bytes(
+    ParameterNode &param, const std::string &ptr, const std::string &len
+)
+{
+    if (length_annotation(param)->name == "size") {
+        return len;
+    }
+    return len + " * sizeof(*" + ptr + ")";
+}
+
+std::string CGeneratorBase::length_fits(
+    ParameterNode &param, const std::string &ptr, const std::string &len, const std::string &max
+)
+{
+    // Compared in elements so that a huge count cannot overflow the byte size
+    if (length_annotation(param)->name == "size") {
+        return len + " <= " + max;
+    }
+    return len + " <= " + max + " / sizeof(*" + ptr + ")";
+}
+
+bool CGeneratorBase::is_async(FunctionNode &node)
+{
+    if (!has_annotation(node.annotations, "async")) {
+        return false;
+    }
+
+    // Completions only carry a status, so results have to be written straight to caller storage
+    size_t n_out = 0;
+    for (const auto &param : node.parameters) {
+        if (param->direction == ParameterNode::Direction::OUT) {
+            n_out++;
+        }
+    }
+    if (n_out > 1) {
+        throw std::runtime_error(
+            "@async function " + std::string(node.name) + " has more than one out parameter"
+        );
+    }
+
+    return true;
+}
+
+std::string CGeneratorBase::async_in_member(FunctionNode &node, const CallShape &shape)
+{
+    if (shape.use_call_reg || shape.packed_in_params.empty()) {
+        return "";
+    }
+
+    if (shape.packed_in_params.size() > 1) {
+        return "struct " + prefix + std::string(node.name) + "_In " + std::string(node.name);
+    }
+    if (!wire_is_ptr(*shape.packed_in_params.front())) {
+        return wire_decl(*shape.packed_in_params.front(), std::string(node.name));
+    }
+    return "";
+}
+
+size_t CGeneratorBase::ring_base(FunctionNode &node)
+{
+    auto it = std::find(ring_abis.begin(), ring_abis.end(), &node.abiversion);
+    if (it != ring_abis.end()) {
+        return it - ring_abis.begin();
+    }
+
+    ring_abis.push_back(&node.abiversion);
+    return ring_abis.size() - 1;
+}
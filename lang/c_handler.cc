@@ -1,61 +1,163 @@
 #include <c_handler.hh>
 
-#include <fstream>
-#include <iostream>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <ast.hh>
+#include <c_bench_generator.hh>
 #include <c_header_generator.hh>
+#include <c_options.hh>
+#include <c_server_generator.hh>
 #include <c_source_generator.hh>
+#include <output_file.hh>
 
-static std::string header_path;
-static std::string user_src_path;
-static std::string user_src_header_path;
-static bool make_weak_symbols = false;
+static COptions options;
 
-bool c_handle_option(const std::string &arg)
+struct COutputs : LangOutputs {
+    std::string header_path;
+    std::string user_src_path;
+    std::string user_src_header_path;
+    std::string server_src_path;
+    std::string bench_src_path;
+
+    bool empty() const override
+    {
+        return header_path.empty() && user_src_path.empty() && user_src_header_path.empty() &&
+               server_src_path.empty() && bench_src_path.empty();
+    }
+
+    // The generated sources include the header by this path
+    std::string header_include_path() const
+    {
+        if (!user_src_header_path.empty()) {
+            return user_src_header_path;
+        }
+        return header_path.substr(header_path.rfind("/") + 1);
+    }
+
+    std::vector<LangOutputFile> files() const override
+    {
+        std::vector<LangOutputFile> files;
+
+        for (const auto &[kind, path] : {
+                 std::pair{ "header", &header_path },
+                 std::pair{ "user-src", &user_src_path },
+                 std::pair{ "server-src", &server_src_path },
+                 std::pair{ "bench-src", &bench_src_path },
+             }) {
+            if (!path->empty()) {
+                files.push_back({ kind, *path });
+            }
+        }
+        return files;
+    }
+
+    std::string fingerprint() const override
+    {
+        return options_fingerprint(options) + "include=" + header_include_path() + "\n";
+    }
+
+    bool stable() const override { return options.stable_output; }
+};
+
+static COutputs outputs;
+
+static bool handle_generation_option(const std::string &arg)
 {
     if (arg.rfind("--weak", 0) == 0) {
-        make_weak_symbols = true;
+        options.make_weak_symbols = true;
+        return true;
+    } else if (arg == "--funcid-cache") {
+        options.funcid_cache = true;
+        return true;
+    } else if (arg == "--batch") {
+        options.batch = true;
+        return true;
+    } else if (arg == "--reg-returns") {
+        options.reg_returns = true;
+        return true;
+    } else if (arg == "--pack-scalars") {
+        options.pack_scalars = true;
+        return true;
+    } else if (arg == "--negotiate") {
+        options.negotiate = true;
+        return true;
+    } else if (arg == "--instrument") {
+        options.instrument = true;
+        return true;
+    } else if (arg == "--usdt") {
+        options.usdt = true;
         return true;
-    } else if (arg.rfind("--header=", 0) == 0) {
-        header_path = arg.substr(9);
+    } else if (arg == "--stable-output") {
+        options.stable_output = true;
+        return true;
+    } else if (arg == "--inline-stubs") {
+        options.inline_stubs = true;
+        return true;
+    } else if (arg.rfind("--inline-arrays=", 0) == 0) {
+        return parse_inline_arrays(arg.substr(16), options);
+    } else if (arg == "--layout=packed") {
+        options.layout = CBlockLayout::PACKED;
+        return true;
+    } else if (arg == "--layout=aligned") {
+        options.layout = CBlockLayout::ALIGNED;
+        return true;
+    }
+    return false;
+}
+
+static bool handle_output_option(const std::string &arg)
+{
+    if (arg.rfind("--header=", 0) == 0) {
+        outputs.header_path = arg.substr(9);
         return true;
     } else if (arg.rfind("--user-src=", 0) == 0) {
-        user_src_path = arg.substr(11);
+        outputs.user_src_path = arg.substr(11);
         return true;
     } else if (arg.rfind("--user-src-header-path=", 0) == 0) {
-        user_src_header_path = arg.substr(23);
+        outputs.user_src_header_path = arg.substr(23);
+        return true;
+    } else if (arg.rfind("--server-src=", 0) == 0) {
+        outputs.server_src_path = arg.substr(13);
+        return true;
+    } else if (arg.rfind("--bench-src=", 0) == 0) {
+        outputs.bench_src_path = arg.substr(12);
         return true;
     }
     return false;
 }
 
-bool c_generate(InterfaceNode *interface)
+bool c_handle_option(const std::string &arg)
 {
-    if (!header_path.empty()) {
-        std::ofstream header_file(header_path);
-        if (!header_file.is_open()) {
-            std::cerr << "Error: Could not open file " << header_path << std::endl;
-            return false;
-        }
-        CHeaderGenerator header_gen(header_file);
-        interface->accept(header_gen);
+    if (handle_output_option(arg)) {
+        return true;
     }
+    return handle_generation_option(arg);
+}
 
-    if (user_src_header_path.empty()) {
-        user_src_header_path = header_path.substr(header_path.rfind("/") + 1);
-    }
+std::unique_ptr<LangOutputs> c_take_outputs()
+{
+    auto taken = std::make_unique<COutputs>(std::move(outputs));
+    outputs = COutputs();
+    return taken;
+}
 
-    if (!user_src_path.empty()) {
-        std::ofstream user_src_file(user_src_path);
-        if (!user_src_file.is_open()) {
-            std::cerr << "Error: Could not open file " << user_src_path << std::endl;
-            return false;
-        }
-        CSourceGenerator source_gen(user_src_file, user_src_header_path, make_weak_symbols);
-        interface->accept(source_gen);
-    }
+bool c_generate(InterfaceNode *interface, const LangOutputs &outputs)
+{
+    auto &paths = static_cast<const COutputs &>(outputs);
+    std::string user_src_header_path = paths.header_include_path();
+    bool stable = options.stable_output;
 
-    return true;
+    return generate_output<CHeaderGenerator>(interface, paths.header_path, stable, options) &&
+           generate_output<CSourceGenerator>(
+               interface, paths.user_src_path, stable, user_src_header_path, options
+           ) &&
+           generate_output<CServerGenerator>(
+               interface, paths.server_src_path, stable, user_src_header_path, options
+           ) &&
+           generate_output<CBenchGenerator>(
+               interface, paths.bench_src_path, stable, user_src_header_path, options
+           );
 }
@@ -1,112 +1,217 @@
 #include <c_header_generator.hh>
 
-#include <uuid.h>
+#include <algorithm>
 
 #include <ast.hh>
 
-#include "config.h"
-
 void CHeaderGenerator::visit(InterfaceNode &node)
 {
-    macro_interface_name = node.name;
-    std::transform(
-        macro_interface_name.begin(),
-        macro_interface_name.end(),
-        macro_interface_name.begin(),
-        ::toupper
-    );
-
-    for (const auto &anno : node.annotations) {
-        if (anno->name == "prefix") {
-            if (anno->args.size() != 1) {
-                throw std::runtime_error("Invalid argument size");
-            }
-
-            auto prefix_param = dynamic_cast<StringLiteralExpressionNode *>(anno->args[0].get());
-            if (!prefix_param) {
-                throw std::runtime_error("Invalid argument type");
-            }
-
-            prefix = prefix_param->value.substr(1, prefix_param->value.size() - 2);
-            macro_prefix = prefix;
-            std::transform(
-                macro_prefix.begin(),
-                macro_prefix.end(),
-                macro_prefix.begin(),
-                ::toupper
-            );
-        } else if (anno->name == "uuid") {
-            if (anno->args.size() != 2) {
-                throw std::runtime_error("Invalid argument size");
+    parse_interface_annotations(node);
+
+    macro_prefix = prefix;
+    std::transform(macro_prefix.begin(), macro_prefix.end(), macro_prefix.begin(), ::toupper);
+
+    std::vector<uint8_t> bytes = interface_uuid(node);
+    if (!bytes.empty()) {
+        buf_macros << "#define UUID_" << macro_interface_name << "_INTERFACE_INIT UUID_INIT("
+                   << std::hex;
+        for (size_t i = 0; i < bytes.size(); i++) {
+            buf_macros << "0x" << static_cast<int>(bytes[i]);
+            if (i < bytes.size() - 1) {
+                buf_macros << ", ";
             }
+        }
+        buf_macros << std::dec << ")\n";
 
-            auto namespace_param = dynamic_cast<StringLiteralExpressionNode *>(anno->args[0].get());
-            if (!namespace_param) {
-                throw std::runtime_error("Invalid argument type");
+        buf_macros << "#define UUID_" << macro_interface_name << "_INTERFACE UUID(" << std::hex;
+        for (size_t i = 0; i < bytes.size(); i++) {
+            buf_macros << "0x" << static_cast<int>(bytes[i]);
+            if (i < bytes.size() - 1) {
+                buf_macros << ", ";
             }
+        }
+        buf_macros << std::dec << ")\n";
+    }
 
-            std::string_view namespace_str =
-                namespace_param->value.substr(1, namespace_param->value.size() - 2);
+    for (const auto &group : node.groups) {
+        group->accept(*this);
+    }
 
-            if (!uuids::uuid::is_valid_uuid(namespace_str)) {
-                throw std::runtime_error("Invalid UUID");
-            }
+    // Interfaces without functions have nothing to instrument
+    bool instrument = options.instrument && n_stats > 0;
+
+    if (options.batch) {
+        std::string batch_type = prefix + "Batch";
+
+        // Calls recorded into a batch are submitted with a single StHandle_CallBatch(). Argument
+        // blocks are copied into the caller-provided arena, so it must stay alive until the batch
+        // has been submitted; per-entry results are left in descs[i].status.
+        buf_types << "\n/* Batching */\n";
+        buf_types << "typedef struct " << batch_type << " {\n";
+        buf_types << "    struct StHandleCallDesc *descs;\n";
+        buf_types << "    size_t count;\n";
+        buf_types << "    size_t capacity;\n";
+        buf_types << "    uint8_t *arena;\n";
+        buf_types << "    size_t arena_used;\n";
+        buf_types << "    size_t arena_size;\n";
+        if (n_batch_bases != 0) {
+            // Resolved on the first call recorded for a (group, abirevision) and handle, so a
+            // batch spread over a few handles queries each of them once
+            buf_types << "    struct {\n";
+            buf_types << "        struct {\n";
+            buf_types << "            StHandle handle;\n";
+            buf_types << "            uint32_t funcid_base;\n";
+            buf_types << "        } slots[" << batch_handles << "];\n";
+            buf_types << "        uint32_t count;\n";
+            buf_types << "    } bases[" << n_batch_bases << "];\n";
+        }
+        buf_types << "} " << batch_type << ";\n";
+
+        buf_functions << "\n/* Batching */\n";
+        buf_functions << "void " << prefix << "BatchBegin(" << batch_type
+                      << " *batch __out, struct StHandleCallDesc *descs __in, size_t capacity __in, "
+                         "void *arena __in, size_t arena_size __in);\n";
+        buf_functions << "StStatus " << prefix << "BatchSubmit(" << batch_type
+                      << " *batch __inout);\n";
+        buf_functions << buf_batch.str();
+    }
 
-            auto uuid = uuids::uuid::from_string(namespace_str);
-            if (!uuid) {
-                throw std::runtime_error("Invalid UUID");
-            }
+    if (buf_negotiate_groups.tellp() > 0) {
+        std::string client_type = prefix + "Client";
+
+        // Negotiate() picks, per group, the newest abirevision the handle implements; calls then
+        // go straight through the ops table selected for it.
+        buf_types << "\n/* Negotiation */\n";
+        buf_types << "struct " << client_type << ";\n\n";
+        buf_types << buf_negotiate_ops.str();
+        buf_types << "typedef struct " << client_type << " {\n";
+        buf_types << "    StHandle handle;\n";
+        buf_types << buf_negotiate_groups.str();
+        buf_types << "} " << client_type << ";\n";
+
+        buf_functions << "\n/* Negotiation */\n";
+        buf_functions << "StStatus " << prefix << "Negotiate(" << client_type
+                      << " *client __out, StHandle handle __in);\n";
+        buf_functions << buf_negotiate_functions.str();
+    }
 
-            auto name_param = dynamic_cast<StringLiteralExpressionNode *>(anno->args[1].get());
-            if (!name_param) {
-                throw std::runtime_error("Invalid argument type");
-            }
+    if (options.funcid_cache) {
+        // Called once a handle is closed or revoked, dropping its cached bases on every thread
+        buf_functions << "\n/* Function ID Cache */\n";
+        buf_functions << "void " << prefix << "InvalidateFuncidCache(StHandle handle __in);\n";
+    }
 
-            std::string_view name_str = name_param->value.substr(1, name_param->value.size() - 2);
+    if (has_async) {
+        std::string ring_type = prefix + "Ring";
+        std::string ring_entry = prefix + "RingEntry";
+
+        // Submission entries carry their own copy of the in block; pointers and out storage
+        // handed to Submit_* must stay valid until the matching completion has been reaped.
+        buf_blocks << "/* Async Rings */\n";
+        buf_blocks << "typedef struct " << ring_entry << " {\n";
+        buf_blocks << "    struct StHandleCallDesc desc;\n";
+        if (buf_ring_members.tellp() > 0) {
+            buf_blocks << "    union {\n";
+            buf_blocks << buf_ring_members.str();
+            buf_blocks << "    } in;\n";
+        }
+        buf_blocks << "} " << ring_entry << ";\n\n";
+
+        // RingInit() resolves the funcid base of every revision with @async functions up front
+        buf_blocks << "typedef struct " << ring_type << " {\n";
+        buf_blocks << "    struct StHandleRing ring;\n";
+        buf_blocks << "    struct {\n";
+        buf_blocks << "        uint32_t funcid_base;\n";
+        buf_blocks << "        StStatus status;\n";
+        buf_blocks << "    } bases[" << ring_abis.size() << "];\n";
+        buf_blocks << "} " << ring_type << ";\n\n";
+
+        buf_functions << "\n/* Async Rings */\n";
+        buf_functions << "StStatus " << prefix << "RingInit(" << ring_type
+                      << " *ring __out, StHandle handle __in, " << ring_entry
+                      << " *sq __in, struct StHandleCompletion *cq __in, uint32_t entries __in);\n";
+        buf_functions << "StStatus " << prefix << "RingDoorbell(" << ring_type
+                      << " *ring __inout);\n";
+        buf_functions << "uint32_t " << prefix << "Reap(" << ring_type
+                      << " *ring __inout, struct StHandleCompletion *cqes __out, "
+                         "uint32_t max_cqes __in);\n";
+        buf_functions << buf_ring_functions.str();
+    }
 
-            uuids::uuid_name_generator gen(uuid.value());
-            auto final_uuid = gen(name_str);
+    if (instrument) {
+        std::string stats_type = prefix + "FunctionStats";
 
-            std::span<const std::byte, 16> bytes = final_uuid.as_bytes();
+        buf_macros << "#define " << macro_interface_name << "_STATS_COUNT (" << n_stats << ")\n";
+        buf_macros << "#define " << macro_interface_name << "_STATS_BUCKETS (32)\n";
 
-            buf_macros << "#define UUID_" << macro_interface_name << "_INTERFACE_INIT UUID_INIT("
-                       << std::hex;
-            for (size_t i = 0; i < bytes.size(); i++) {
-                buf_macros << "0x" << static_cast<int>(bytes[i]);
-                if (i < bytes.size() - 1) {
-                    buf_macros << ", ";
-                }
-            }
-            buf_macros << std::dec << ")\n";
-
-            buf_macros << "#define UUID_" << macro_interface_name << "_INTERFACE UUID(" << std::hex;
-            for (size_t i = 0; i < bytes.size(); i++) {
-                buf_macros << "0x" << static_cast<int>(bytes[i]);
-                if (i < bytes.size() - 1) {
-                    buf_macros << ", ";
-                }
-            }
-            buf_macros << std::dec << ")\n";
-        }
+        // Function IDs restart in every group, so the slots are indexed by <IF>_STATS_* instead.
+        // Latency bucket i counts calls that took [2^i, 2^(i+1)) ns, the last one anything slower.
+        buf_types << "\n/* Instrumentation */\n";
+        buf_types << "typedef struct " << stats_type << " {\n";
+        buf_types << "    uint64_t calls;\n";
+        buf_types << "    uint64_t errors;\n";
+        buf_types << "    uint64_t latency[" << macro_interface_name << "_STATS_BUCKETS];\n";
+        buf_types << "} " << stats_type << ";\n";
     }
 
-    for (const auto &group : node.groups) {
-        group->accept(*this);
+    if (buf_server_ops.tellp() > 0) {
+        // desc->funcid is relative to the funcid base handed out for the (group, abirevision) the
+        // caller resolved; a NULL handler is reported to the caller as STATUS_NOT_SUPPORTED.
+        buf_types << "\n/* Server Dispatch */\n";
+        buf_types << "struct StHandleCallDesc;\n\n";
+        buf_types << "struct " << prefix << "ServerOps {";
+        buf_types << buf_server_ops.str();
+        buf_types << "};\n\n";
+        buf_types << "struct " << prefix << "Server {\n";
+        buf_types << "    const struct " << prefix << "ServerOps *ops;\n";
+        buf_types << "    void *ctx;\n";
+        buf_types << "};\n";
+
+        buf_functions << "\n/* Server Dispatch */\n";
+        buf_functions << "StStatus " << prefix
+                      << "Dispatch(void *server __in, uint32_t group __in, uint64_t version __in, "
+                         "struct StHandleCallDesc *desc __inout);\n";
+        buf_functions << buf_server_functions.str();
     }
 
     out << "/* =====================================================================\n";
-    out << " * Auto-generated by sidlc v" << SIDLC_VERSION << " (" << SIDLC_GIT_HASH << ")\n";
+    out << " * Auto-generated by " << generated_by() << "\n";
     out << " * Target Interface: " << node.name << "\n";
     out << " * DO NOT EDIT THIS FILE MANUALLY!\n";
     out << " * ===================================================================== */\n\n";
 
     out << "#ifndef __SIDL_INTERFACE_" << macro_interface_name << "_H__\n";
     out << "#define __SIDL_INTERFACE_" << macro_interface_name << "_H__\n\n";
-    out << "#include <stdint.h>\n\n";
+    out << "#include <stdint.h>\n";
+    if (options.batch || buf_asserts.tellp() > 0 || buf_bitfields.tellp() > 0) {
+        out << "#include <stddef.h>\n";
+    }
+    if (instrument) {
+        out << "#include <stdio.h>\n";
+    }
+    if (has_inline_arrays) {
+        out << "#include <string.h>\n";
+    }
+    if (instrument && options.inline_stubs) {
+        out << "#include <time.h>\n";
+    }
+    if (options.usdt && options.inline_stubs) {
+        out << "#include <sys/sdt.h>\n";
+    }
+    out << "\n";
     out << "#include <strata/status.h>\n";
     out << "#include <strata/macros.h>\n";
     out << "#include <strata/handle.h>\n\n";
     out << "#include <strata/uuid.h>\n\n";
+    if (options.inline_stubs && (has_shared || options.funcid_cache)) {
+        if (has_shared) {
+            out << "#include <strata/shm.h>\n";
+        }
+        if (options.funcid_cache) {
+            out << "#include <stdatomic.h>\n";
+        }
+        out << "\n";
+    }
 
     if (buf_macros.tellp() > 0) {
         out << "/* Constants & Bitmasks */\n";
@@ -118,6 +223,50 @@ void CHeaderGenerator::visit(InterfaceNode &node)
         out << buf_types.str() << "\n";
     }
 
+    if (buf_bitfields.tellp() > 0) {
+        out << "/* Bitfield Accessors */\n";
+        out << buf_bitfields.str();
+    }
+
+    if (buf_blocks.tellp() > 0) {
+        out << "/* Argument Blocks */\n";
+        out << buf_blocks.str();
+    }
+
+    if (buf_asserts.tellp() > 0) {
+        out << "/* Layout Checks */\n";
+        out << buf_asserts.str() << "\n";
+    }
+
+    if (instrument) {
+        // Every thread records into its own slots; collecting sums the slots of all threads
+        // that ever made a call, including those that have exited since.
+        std::string stats_type = prefix + "FunctionStats";
+
+        out << "/* Instrumentation */\n";
+        out << "void " << prefix
+            << "RecordStats(uint32_t index __in, StStatus status __in, uint64_t start_ns __in);\n";
+        out << "void " << prefix << "CollectStats(" << stats_type << " *stats __out);\n";
+        out << "void " << prefix << "DumpStats(FILE *stream __in);\n\n";
+    }
+
+    if (options.inline_stubs) {
+        // The epoch and per-thread caches are defined once, in the user source
+        out << "/* Inline Stubs */\n";
+        out << "static const struct StUuid " << stub_name("interface_uuid") << " = "
+            << "UUID_" << macro_interface_name << "_INTERFACE_INIT;\n\n";
+        if (options.funcid_cache) {
+            emit_funcid_cache_entry(out);
+            out << "extern _Atomic uint32_t " << stub_name("funcid_cache_epoch") << "["
+                << stub_name("FUNCID_CACHE_SIZE") << "];\n";
+            out << buf_stub_cache.str() << "\n";
+            emit_funcid_cache_query(out);
+        }
+        if (instrument) {
+            emit_stats_now(out);
+        }
+    }
+
     if (buf_functions.tellp() > 0) {
         out << "/* Functions & Views */\n";
         out << buf_functions.str() << "\n";
@@ -141,14 +290,36 @@ void CHeaderGenerator::visit(GroupNode &node)
     buf_macros << "#define " << macro_interface_name << "_GROUP_" << macro_group_name << " ("
                << node.id << ")\n";
 
+    std::streampos ops_start = buf_negotiate_ops.tellp();
+
     for (const auto &abi : node.abiversions) {
+        if (options.negotiate && !abi->functions.empty() &&
+            buf_negotiate_ops.tellp() == ops_start) {
+            buf_negotiate_ops << "struct " << prefix << node.name << "_Ops {\n";
+        }
+
         abi->accept(*this);
+
+        if (!abi->functions.empty()) {
+            buf_server_functions << "StStatus " << prefix << "Dispatch_" << node.name << "_"
+                                 << abi->version
+                                 << "(void *server __in, struct StHandleCallDesc *desc __inout);\n";
+        }
+    }
+
+    if (buf_negotiate_ops.tellp() != ops_start) {
+        buf_negotiate_ops << "};\n\n";
+        buf_negotiate_groups << "    struct {\n";
+        buf_negotiate_groups << "        const struct " << prefix << node.name << "_Ops *ops;\n";
+        buf_negotiate_groups << "        uint64_t version;\n";
+        buf_negotiate_groups << "        uint32_t funcid_base;\n";
+        buf_negotiate_groups << "    } " << node.name << ";\n";
     }
 }
 
 void CHeaderGenerator::visit(AbiversionNode &node)
 {
-    if (!node.bitfields.empty()) {
+    if (!node.bitfields.empty() || !node.functions.empty()) {
         buf_macros << "\n/* ABI Version " << node.version << " */\n";
     }
 
@@ -157,7 +328,15 @@ void CHeaderGenerator::visit(AbiversionNode &node)
     }
 
     if (!node.functions.empty()) {
+        n_batch_bases++;
         buf_functions << "\n/* ABI Version " << node.version << " */\n";
+        if (options.inline_stubs && options.funcid_cache) {
+            buf_stub_cache << "extern _Thread_local struct " << stub_name("FuncidCacheEntry") << " "
+                           << stub_name("funcid_cache_") << node.group.id << "_" << node.version
+                           << "[" << stub_name("FUNCID_CACHE_SIZE") << "];\n";
+        }
+        buf_server_ops << "\n    /* Group " << node.group.name << ", ABI Version " << node.version
+                       << " */\n";
     }
 
     for (const auto &b : node.bitfields) {
@@ -180,10 +359,13 @@ void CHeaderGenerator::visit(AbiversionNode &node)
 void CHeaderGenerator::visit(StructNode &node)
 {
     std::string attributes = "";
+    std::string type_name = prefix + std::string(node.name);
 
+    // The layout pass has already validated the annotation
     for (const auto &anno : node.annotations) {
-        if (anno->name == "align_size" && !anno->args.empty()) {
-            attributes += " __attribute__((aligned(16)))";
+        if (anno->name == "align_size") {
+            auto align_param = dynamic_cast<NumberLiteralExpressionNode *>(anno->args[0]);
+            attributes += " __attribute__((aligned(" + std::to_string(align_param->value) + ")))";
         }
     }
 
@@ -200,6 +382,16 @@ void CHeaderGenerator::visit(StructNode &node)
     }
 
     buf_types << "}" << attributes << " " << prefix << node.name << ";\n\n";
+
+    for (const auto &field : node.fields) {
+        emit_layout_assert(
+            "offsetof(" + type_name + ", " + std::string(field->name) + ")",
+            field->offset,
+            type_name + " " + std::string(field->name) + " offset"
+        );
+    }
+    emit_layout_assert("sizeof(" + type_name + ")", node.size, type_name + " size");
+    emit_layout_assert("_Alignof(" + type_name + ")", node.alignment, type_name + " alignment");
 }
 
 void CHeaderGenerator::visit(BitfieldNode &node)
@@ -210,12 +402,165 @@ void CHeaderGenerator::visit(BitfieldNode &node)
 
     buf_types << "typedef " << to_c_type(prefix, *node.base_type) << " " << prefix << node.name
               << ";\n";
+    emit_layout_assert(
+        "sizeof(" + prefix + std::string(node.name) + ")",
+        node.base_type->type_size,
+        prefix + std::string(node.name) + " size"
+    );
 
     for (const auto &field : node.fields) {
         buf_macros << "#define " << macro_interface_name << "_" << macro_name << "_" << field->name
                    << " (" << (1ULL << field->bits) - 1 << "ULL << " << offset << ")\n";
         offset += field->bits;
     }
+
+    emit_bitfield_accessors(node);
+    emit_bitfield_bulk(node);
+}
+
+std::string CHeaderGenerator::bitfield_field_type(uint64_t bits)
+{
+    for (uint64_t width = 8; width < 64; width *= 2) {
+        if (bits <= width) {
+            return "uint" + std::to_string(width) + "_t";
+        }
+    }
+    return "uint64_t";
+}
+
+void CHeaderGenerator::emit_bitfield_accessors(BitfieldNode &node)
+{
+    std::string type = prefix + std::string(node.name);
+    std::string fields_type = type + "_Fields";
+    std::string macro_name = std::string(node.name);
+    std::transform(macro_name.begin(), macro_name.end(), macro_name.begin(), ::toupper);
+    std::stringstream &os = buf_bitfields;
+
+    // Everything goes through uint64_t so that signed base types never shift into their sign bit
+    uint64_t offset = 0;
+    for (const auto &field : node.fields) {
+        std::string mask = macro_interface_name + "_" + macro_name + "_" + std::string(field->name);
+        std::string field_type = bitfield_field_type(field->bits);
+
+        os << "static inline " << field_type << " " << type << "_Get_" << field->name << "("
+           << type << " value __in)\n";
+        os << "{\n";
+        os << "    return (" << field_type << ")(((uint64_t)value & " << mask << ") >> " << offset
+           << ");\n";
+        os << "}\n\n";
+
+        os << "static inline " << type << " " << type << "_With_" << field->name << "(" << type
+           << " value __in, " << field_type << " field __in)\n";
+        os << "{\n";
+        os << "    return (" << type << ")(((uint64_t)value & ~" << mask
+           << ") | (((uint64_t)field << " << offset << ") & " << mask << "));\n";
+        os << "}\n\n";
+
+        os << "static inline void " << type << "_Set_" << field->name << "(" << type
+           << " *value __inout, " << field_type << " field __in)\n";
+        os << "{\n";
+        os << "    *value = " << type << "_With_" << field->name << "(*value, field);\n";
+        os << "}\n\n";
+
+        offset += field->bits;
+    }
+
+    os << "typedef struct " << fields_type << " {\n";
+    for (const auto &field : node.fields) {
+        os << "    " << bitfield_field_type(field->bits) << " " << field->name << ";\n";
+    }
+    os << "} " << fields_type << ";\n\n";
+
+    // Out-of-range field values are masked off rather than spilling into their neighbours
+    offset = 0;
+    os << "static inline " << type << " " << type << "_Pack(const " << fields_type
+       << " *fields __in)\n";
+    os << "{\n";
+    os << "    return (" << type << ")(";
+    for (size_t i = 0; i < node.fields.size(); ++i) {
+        auto &field = *node.fields[i];
+        std::string mask = macro_interface_name + "_" + macro_name + "_" + std::string(field.name);
+
+        os << (i == 0 ? "" : " |\n        ") << "(((uint64_t)fields->" << field.name << " << "
+           << offset << ") & " << mask << ")";
+        offset += field.bits;
+    }
+    os << (node.fields.empty() ? "0);\n" : ");\n");
+    os << "}\n\n";
+
+    os << "static inline " << fields_type << " " << type << "_Unpack(" << type
+       << " value __in)\n";
+    os << "{\n";
+    os << "    " << fields_type << " fields;\n";
+    if (node.fields.empty()) {
+        os << "    (void)value;\n";
+    }
+    for (const auto &field : node.fields) {
+        os << "    fields." << field->name << " = " << type << "_Get_" << field->name
+           << "(value);\n";
+    }
+    os << "    return fields;\n";
+    os << "}\n\n";
+}
+
+void CHeaderGenerator::emit_bitfield_bulk(BitfieldNode &node)
+{
+    std::string type = prefix + std::string(node.name);
+    size_t size = node.base_type->type_size;
+    size_t n_lanes = 16 / size;
+    std::string lane = "uint" + std::to_string(size * 8) + "_t";
+    std::string counter = "int" + std::to_string(size * 8) + "_t";
+    std::string lanes_type = "typedef " + lane + " Lanes __attribute__((vector_size(16)));\n";
+    std::string load = "        __builtin_memcpy(&lanes, values + i, sizeof(lanes));\n";
+    std::stringstream &os = buf_bitfields;
+
+    // Written against 16-byte GNU vectors, which are plain SSE2 on x86_64, so the scans are SIMD
+    // at any optimisation level; the scalar tails take the remaining values.
+    os << "static inline size_t " << type << "_CountMatching(const " << type
+       << " *values __in, size_t count __in, " << type << " mask __in, " << type
+       << " expected __in)\n";
+    os << "{\n";
+    os << "    " << lanes_type;
+    os << "    typedef " << counter << " Counts __attribute__((vector_size(16)));\n";
+    os << "    size_t matches = 0, i = 0, j, round;\n";
+    // A lane subtracts -1 per match, so it is drained before it can count past 255
+    os << "    while (count - i >= " << n_lanes << ") {\n";
+    os << "        Counts counts = { 0 };\n";
+    os << "        for (round = 0; round < 255 && count - i >= " << n_lanes << "; round++, i += "
+       << n_lanes << ") {\n";
+    os << "            Lanes lanes;\n";
+    os << "    " << load;
+    os << "            counts -= (Counts)((lanes & (" << lane << ")mask) == (" << lane
+       << ")expected);\n";
+    os << "        }\n";
+    os << "        for (j = 0; j < " << n_lanes << "; j++) { matches += (" << lane
+       << ")counts[j]; }\n";
+    os << "    }\n";
+    os << "    for (; i < count; i++) { matches += (values[i] & mask) == expected; }\n";
+    os << "    return matches;\n";
+    os << "}\n\n";
+
+    for (const auto &op : { "Or", "And" }) {
+        bool is_or = std::string(op) == "Or";
+        std::string c_op = is_or ? " |= " : " &= ";
+
+        os << "static inline " << type << " " << type << "_Reduce" << op << "(const " << type
+           << " *values __in, size_t count __in)\n";
+        os << "{\n";
+        os << "    " << lanes_type;
+        os << "    Lanes acc = " << (is_or ? "{ 0 }" : "~(Lanes){ 0 }") << ";\n";
+        os << "    " << lane << " result = " << (is_or ? "0" : "(" + lane + ")-1") << ";\n";
+        os << "    size_t i = 0, j;\n";
+        os << "    for (; count - i >= " << n_lanes << "; i += " << n_lanes << ") {\n";
+        os << "        Lanes lanes;\n";
+        os << load;
+        os << "        acc" << c_op << "lanes;\n";
+        os << "    }\n";
+        os << "    for (j = 0; j < " << n_lanes << "; j++) { result" << c_op << "acc[j]; }\n";
+        os << "    for (; i < count; i++) { result" << c_op << "(" << lane << ")values[i]; }\n";
+        os << "    return (" << type << ")result;\n";
+        os << "}\n\n";
+    }
 }
 
 void CHeaderGenerator::visit(EnumNode &node)
@@ -225,6 +570,11 @@ void CHeaderGenerator::visit(EnumNode &node)
 
     buf_types << "typedef " << to_c_type(prefix, *node.base_type) << " " << prefix << node.name
               << ";\n";
+    emit_layout_assert(
+        "sizeof(" + prefix + std::string(node.name) + ")",
+        node.base_type->type_size,
+        prefix + std::string(node.name) + " size"
+    );
 
     for (const auto &member : node.members) {
         buf_macros << "#define " << macro_interface_name << "_" << macro_name << "_" << member->name
@@ -232,41 +582,142 @@ void CHeaderGenerator::visit(EnumNode &node)
     }
 }
 
-void CHeaderGenerator::visit(FunctionNode &node)
+void CHeaderGenerator::emit_arg_block(
+    FunctionNode &node, const std::string &suffix, std::vector<ParameterNode *> params
+)
 {
-    if (node.parameters.empty()) {
-        buf_functions << "StStatus " << prefix << node.name << "(StHandle handle __in";
-    } else {
-        buf_functions << "StStatus " << prefix << node.name << "(StHandle handle __in, ";
+    std::string block_name = "struct " + prefix + std::string(node.name) + "_" + suffix;
+    BlockLayout block = block_layout(params);
+    size_t size = block.size;
+    size_t alignment = block.alignment;
+
+    buf_blocks << block_name << " {\n";
+    for (const auto &field : block.fields) {
+        auto param = field.param;
+        if (param->direction == ParameterNode::Direction::OUT) {
+            buf_blocks << "    " << value_decl(*param->type, std::string(param->name)) << ";\n";
+        } else {
+            buf_blocks << "    " << wire_decl(*param, std::string(param->name)) << ";\n";
+        }
+
+        emit_layout_assert(
+            "offsetof(" + block_name + ", " + std::string(param->name) + ")",
+            field.offset,
+            block_name + " " + std::string(param->name) + " offset"
+        );
     }
 
-    for (const auto &param : node.parameters) {
-        bool add_pointer = param->direction != ParameterNode::Direction::IN;
+    emit_layout_assert("sizeof(" + block_name + ")", size, block_name + " size");
 
-        if (param->type->is_ptr) {
-            buf_functions << to_c_type(prefix, *param->type) << (add_pointer ? "*" : "")
-                          << param->name;
-        } else {
-            buf_functions << to_c_type(prefix, *param->type) << (add_pointer ? " *" : " ")
-                          << param->name;
-        }
+    if (layout == CBlockLayout::PACKED) {
+        buf_blocks << "} __packed;\n\n";
+        return;
+    }
+    buf_blocks << "};\n\n";
+
+    std::string macro_name = std::string(node.name) + "_" + suffix;
+    std::transform(macro_name.begin(), macro_name.end(), macro_name.begin(), ::toupper);
+
+    buf_macros << "#define " << macro_interface_name << "_" << macro_name << "_SIZE (" << size
+               << ")\n";
+    buf_macros << "#define " << macro_interface_name << "_" << macro_name << "_ALIGN ("
+               << alignment << ")\n";
+}
+
+void CHeaderGenerator::emit_layout_assert(
+    const std::string &expr, size_t value, const std::string &what
+)
+{
+    buf_asserts << "_Static_assert(" << expr << " == " << value << ", \"" << what << "\");\n";
+}
+
+void CHeaderGenerator::emit_arg_blocks(FunctionNode &node, const CallShape &shape)
+{
+    if (shape.use_call_reg) {
+        return;
+    }
+
+    if (shape.packed_in_params.size() > 1) {
+        emit_arg_block(node, "In", shape.packed_in_params);
+    }
+
+    if (shape.packed_out_params.size() > 1) {
+        emit_arg_block(node, "Out", shape.packed_out_params);
+    }
+}
+
+void CHeaderGenerator::visit(FunctionNode &node)
+{
+    std::stringstream params;
+
+    for (const auto &param : node.parameters) {
+        params << ", " << param_decl(*param, std::string(param->name));
 
         switch (param->direction) {
         case ParameterNode::Direction::IN:
-            buf_functions << " __in";
+            params << " __in";
             break;
         case ParameterNode::Direction::OUT:
-            buf_functions << " __out";
+            params << " __out";
             break;
         case ParameterNode::Direction::INOUT:
-            buf_functions << " __inout";
+            params << " __inout";
             break;
         }
+    }
+
+    buf_macros << "#define " << funcid_macro(node) << " (" << node.id << ")\n";
+    if (options.instrument) {
+        buf_macros << "#define " << stats_macro(node) << " (" << n_stats++ << ")\n";
+    }
+
+    buf_server_ops << "    StStatus (*" << node.name << ")(void *ctx" << params.str() << ");\n";
+
+    CallShape shape = classify(node);
+
+    if (options.inline_stubs) {
+        emit_stub(buf_functions, node, shape);
+    } else {
+        buf_functions << "StStatus " << prefix << node.name << "(StHandle handle __in"
+                      << params.str() << ");\n";
+    }
 
-        if (&param != &node.parameters.back()) {
-            buf_functions << ", ";
+    emit_arg_blocks(node, shape);
+
+    if (is_async(node)) {
+        std::string member = async_in_member(node, shape);
+
+        has_async = true;
+        ring_base(node);
+        if (!member.empty()) {
+            buf_ring_members << "        " << member << ";\n";
+        }
+        buf_ring_functions << "StStatus " << prefix << "Submit_" << node.name << "(" << prefix
+                           << "Ring *ring __inout, uint64_t user_data __in" << params.str()
+                           << ");\n";
+    }
+
+    if (options.negotiate) {
+        std::string group_name(node.abiversion.group.name);
+
+        buf_negotiate_ops << "    StStatus (*" << node.name << ")(const struct " << prefix
+                          << "Client *client" << params.str() << ");\n";
+
+        buf_negotiate_functions << "static inline StStatus " << prefix << "Client_" << node.name
+                                << "(const " << prefix << "Client *client __in" << params.str()
+                                << ")\n";
+        buf_negotiate_functions << "{\n";
+        buf_negotiate_functions << "    return client->" << group_name << ".ops->" << node.name
+                                << "(client";
+        for (const auto &param : node.parameters) {
+            buf_negotiate_functions << ", " << param->name;
         }
+        buf_negotiate_functions << ");\n";
+        buf_negotiate_functions << "}\n\n";
     }
 
-    buf_functions << ");\n";
+    if (options.batch) {
+        buf_batch << "StStatus " << prefix << "Batch_" << node.name << "(" << prefix
+                  << "Batch *batch __inout, StHandle handle __in" << params.str() << ");\n";
+    }
 }
@@ -0,0 +1,49 @@
+#include <c_options.hh>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+bool parse_inline_arrays(const std::string &value, COptions &options)
+{
+    size_t bytes;
+
+    try {
+        size_t pos;
+        bytes = std::stoul(value, &pos);
+        if (pos != value.size()) {
+            return false;
+        }
+    } catch (const std::exception &) {
+        return false;
+    }
+
+    // Payload slots are whole words
+    options.inline_array_max = (bytes + 7) / 8 * 8;
+    return true;
+}
+
+std::string options_fingerprint(const COptions &options)
+{
+    // Every field in declaration order, so equivalent command lines share cache entries
+    std::string key;
+
+    for (const auto &[name, value] : {
+             std::pair{ "weak", options.make_weak_symbols },
+             std::pair{ "funcid-cache", options.funcid_cache },
+             std::pair{ "batch", options.batch },
+             std::pair{ "pack-scalars", options.pack_scalars },
+             std::pair{ "reg-returns", options.reg_returns },
+             std::pair{ "inline-stubs", options.inline_stubs },
+             std::pair{ "negotiate", options.negotiate },
+             std::pair{ "instrument", options.instrument },
+             std::pair{ "usdt", options.usdt },
+             std::pair{ "stable-output", options.stable_output },
+         }) {
+        key += std::string(name) + "=" + (value ? "1" : "0") + "\n";
+    }
+    key += "inline-arrays=" + std::to_string(options.inline_array_max) + "\n";
+    key += std::string("layout=") +
+           (options.layout == CBlockLayout::PACKED ? "packed" : "aligned") + "\n";
+    return key;
+}
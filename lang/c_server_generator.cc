@@ -0,0 +1,271 @@
+#include <c_server_generator.hh>
+
+#include <algorithm>
+#include <vector>
+
+#include <ast.hh>
+
+void CServerGenerator::visit(InterfaceNode &node)
+{
+    parse_interface_annotations(node);
+
+    for (const auto &group : node.groups) {
+        group->accept(*this);
+    }
+
+    out << "/* =====================================================================\n";
+    out << " * Auto-generated by " << generated_by() << "\n";
+    out << " * Target Interface: " << node.name << "\n";
+    out << " * DO NOT EDIT THIS FILE MANUALLY!\n";
+    out << " * ===================================================================== */\n\n";
+
+    out << "#include \"" << header_name << "\"\n\n";
+    out << "#include <stdint.h>\n\n";
+    out << "#include <strata/status.h>\n";
+    out << "#include <strata/macros.h>\n";
+    out << "#include <strata/handle.h>\n";
+    if (has_shared) {
+        out << "#include <strata/shm.h>\n";
+    }
+    out << "\n";
+
+    if (buf_decoders.tellp() == 0) {
+        return;
+    }
+
+    out << "typedef StStatus (*DispatchFn)(const struct " << prefix
+        << "ServerOps *ops, void *ctx, struct StHandleCallDesc *desc);\n\n";
+
+    out << "/* Decoders */\n";
+    out << buf_decoders.str();
+
+    out << "/* Dispatch Tables */\n";
+    out << buf_tables.str();
+
+    out << "StStatus " << prefix
+        << "Dispatch(void *server __in, uint32_t group __in, uint64_t version __in, "
+           "struct StHandleCallDesc *desc __inout)\n";
+    out << "{\n";
+    out << "    switch (group) {\n";
+    out << buf_dispatch.str();
+    out << "    }\n";
+    out << "    return STATUS_NOT_SUPPORTED;\n";
+    out << "}\n";
+}
+
+void CServerGenerator::visit(GroupNode &node)
+{
+    std::string macro_group_name(node.name);
+    std::transform(
+        macro_group_name.begin(),
+        macro_group_name.end(),
+        macro_group_name.begin(),
+        ::toupper
+    );
+
+    // Function IDs keep counting across the abirevisions of a group, so the table for a revision
+    // also routes every function introduced by an older one.
+    std::vector<FunctionNode *> functions;
+    bool has_case = false;
+
+    for (const auto &abi : node.abiversions) {
+        for (const auto &f : abi->functions) {
+            f->accept(*this);
+            functions.push_back(f);
+        }
+
+        if (abi->functions.empty()) {
+            continue;
+        }
+
+        std::string table_name =
+            "dispatch_table_" + std::to_string(node.id) + "_" + std::to_string(abi->version);
+        std::string dispatch_name =
+            prefix + "Dispatch_" + std::string(node.name) + "_" + std::to_string(abi->version);
+
+        buf_tables << "static const DispatchFn " << table_name << "[] = {\n";
+        for (const auto &f : functions) {
+            buf_tables << "    [" << funcid_macro(*f) << "] = dispatch_" << f->name << ",\n";
+        }
+        buf_tables << "};\n\n";
+
+        buf_tables << "StStatus " << dispatch_name
+                   << "(void *server __in, struct StHandleCallDesc *desc __inout)\n";
+        buf_tables << "{\n";
+        buf_tables << "    const struct " << prefix << "Server *srv = server;\n";
+        buf_tables << "    if (desc->funcid >= sizeof(" << table_name << ") / sizeof(" << table_name
+                   << "[0])) { return STATUS_NOT_SUPPORTED; }\n";
+        buf_tables << "    return " << table_name << "[desc->funcid](srv->ops, srv->ctx, desc);\n";
+        buf_tables << "}\n\n";
+
+        if (!has_case) {
+            buf_dispatch << "    case " << macro_interface_name << "_GROUP_" << macro_group_name
+                         << ":\n";
+            buf_dispatch << "        switch (version) {\n";
+            has_case = true;
+        }
+        buf_dispatch << "        case " << abi->version << ":\n";
+        buf_dispatch << "            return " << dispatch_name << "(server, desc);\n";
+    }
+
+    if (has_case) {
+        buf_dispatch << "        }\n";
+        buf_dispatch << "        break;\n";
+    }
+}
+
+std::string CServerGenerator::cast_type(ParameterNode &param)
+{
+    std::string type = param_decl(param, "");
+
+    while (!type.empty() && type.back() == ' ') {
+        type.pop_back();
+    }
+    return type;
+}
+
+void CServerGenerator::visit(FunctionNode &node)
+{
+    CallShape shape = classify(node);
+    const auto &packed_in_params = shape.packed_in_params;
+    const auto &packed_out_params = shape.packed_out_params;
+    const auto &reg_out_params = shape.reg_out_params;
+
+    buf_decoders << "static StStatus dispatch_" << node.name << "(const struct " << prefix
+                 << "ServerOps *ops, void *ctx, struct StHandleCallDesc *desc)\n";
+    buf_decoders << "{\n";
+    buf_decoders << "    StStatus status;\n";
+
+    if (!shape.use_call_reg && packed_in_params.size() > 1) {
+        buf_decoders << "    const struct " << prefix << node.name << "_In *in = desc->in;\n";
+    }
+    if (!shape.use_call_reg && packed_out_params.size() > 1) {
+        buf_decoders << "    struct " << prefix << node.name << "_Out *out = desc->out;\n";
+        for (const auto &param : packed_out_params) {
+            buf_decoders << "    " << value_decl(*param->type, std::string(param->name)) << ";\n";
+        }
+    }
+    if (!reg_out_params.empty()) {
+        buf_decoders << "    unsigned long *rets = desc->out;\n";
+        for (const auto &param : reg_out_params) {
+            buf_decoders << "    " << value_decl(*param->type, "_" + std::string(param->name))
+                         << ";\n";
+        }
+    }
+
+    for (const auto &param : node.parameters) {
+        if (is_shared(*param)) {
+            buf_decoders << "    void *" << param->name << ";\n";
+        } else if (length_annotation(*param)) {
+            buf_decoders << "    " << param_decl(*param, std::string(param->name)) << ";\n";
+        }
+    }
+    if (has_inline_payloads(node)) {
+        buf_decoders << "    const uint8_t *payload;\n";
+        buf_decoders << "    size_t payload_left = 0;\n";
+    }
+
+    // Decode each parameter from wherever the client stub placed it
+    std::vector<std::string> args;
+    for (size_t i = 0; i < node.parameters.size(); ++i) {
+        auto param = node.parameters[i];
+        std::string type = is_shared(*param) ? "uint64_t" : cast_type(*param);
+        size_t word, shift;
+
+        if (find_reg_field(shape, param, word, shift)) {
+            std::string value = "desc->args[" + std::to_string(word) + "]";
+            if (shift != 0) {
+                value = "(" + value + " >> " + std::to_string(shift) + ")";
+            }
+            args.push_back("(" + type + ")" + value);
+        } else if (param->direction == ParameterNode::Direction::OUT) {
+            if (!reg_out_params.empty()) {
+                args.push_back("&_" + std::string(param->name));
+            } else if (packed_out_params.size() > 1) {
+                args.push_back("&" + std::string(param->name));
+            } else {
+                args.push_back("(" + type + ")desc->out");
+            }
+        } else if (packed_in_params.size() > 1) {
+            args.push_back("in->" + std::string(param->name));
+        } else if (wire_is_ptr(*param) && param->direction == ParameterNode::Direction::IN) {
+            args.push_back("(" + type + ")desc->in");
+        } else {
+            args.push_back("*(" + type + " const *)desc->in");
+        }
+    }
+
+    buf_decoders << "    if (ops->" << node.name << " == NULL) { return STATUS_NOT_SUPPORTED; }\n";
+
+    // Shared offsets are resolved against this side's mapping of the handle's region
+    for (size_t i = 0; i < node.parameters.size(); ++i) {
+        auto param = node.parameters[i];
+        if (is_shared(*param)) {
+            std::string len;
+            if (auto length = length_param(node, *param)) {
+                auto it = std::find(node.parameters.begin(), node.parameters.end(), length);
+                len = args[it - node.parameters.begin()];
+            }
+
+            buf_decoders << "    status = StShm_FromOffset(desc->handle, " << args[i] << ", "
+                         << shared_extent(node, *param, len) << ", &" << param->name << ");\n";
+            buf_decoders << "    if (!CHECK_SUCCESS(status)) { return status; }\n";
+            args[i] = "(" + cast_type(*param) + ")" + std::string(param->name);
+        }
+    }
+
+    // Payloads the client copied in follow the block in parameter order, each padded to 8 bytes.
+    // The lengths come from the client, so each one is checked against the in size the transport
+    // reports before the handler gets to see the payload.
+    if (has_inline_payloads(node)) {
+        std::string offset = "(sizeof(*in) + 7) / 8 * 8";
+
+        buf_decoders << "    payload = (const uint8_t *)desc->in + " << offset << ";\n";
+        buf_decoders << "    if (desc->in_size > " << offset << ") {\n";
+        buf_decoders << "        payload_left = (desc->in_size - " << offset << ") / 8 * 8;\n";
+        buf_decoders << "    }\n";
+    }
+    for (size_t i = 0; i < node.parameters.size(); ++i) {
+        auto param = node.parameters[i];
+        auto length = length_param(node, *param);
+        if (!is_inline_array(*param)) {
+            continue;
+        }
+
+        std::string name(param->name);
+        std::string len = "in->" + std::string(length->name);
+        buf_decoders << "    " << name << " = in->" << name << ";\n";
+        buf_decoders << "    if (" << name << " == NULL && " << len << " != 0) {\n";
+        buf_decoders << "        if (!(" << length_fits(*param, name, len, "payload_left")
+                     << ")) { return STATUS_INVALID_ARGUMENT; }\n";
+        buf_decoders << "        " << name << " = (" << cast_type(*param) << ")payload;\n";
+        buf_decoders << "        payload += (" << length_bytes(*param, name, len)
+                     << " + 7) / 8 * 8;\n";
+        buf_decoders << "        payload_left -= (" << length_bytes(*param, name, len)
+                     << " + 7) / 8 * 8;\n";
+        buf_decoders << "    }\n";
+        args[i] = name;
+    }
+
+    buf_decoders << "    status = ops->" << node.name << "(ctx";
+    for (const auto &arg : args) {
+        buf_decoders << ", " << arg;
+    }
+    buf_decoders << ");\n";
+
+    if (!shape.use_call_reg && packed_out_params.size() > 1) {
+        buf_decoders << "    if (!CHECK_SUCCESS(status)) { return status; }\n";
+        for (const auto &param : packed_out_params) {
+            buf_decoders << "    out->" << param->name << " = " << param->name << ";\n";
+        }
+    }
+    if (!reg_out_params.empty()) {
+        buf_decoders << "    if (!CHECK_SUCCESS(status)) { return status; }\n";
+        for (size_t i = 0; i < reg_out_params.size(); ++i) {
+            buf_decoders << "    rets[" << i << "] = (unsigned long)_" << reg_out_params[i]->name
+                         << ";\n";
+        }
+    }
+    buf_decoders << "    return status;\n";
+    buf_decoders << "}\n\n";
+}
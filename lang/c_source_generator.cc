@@ -1,294 +1,753 @@
 #include <c_source_generator.hh>
 
+#include <algorithm>
+#include <vector>
+
 #include <uuid.h>
 
 #include <arch_abi.hh>
 #include <ast.hh>
 
-#include "config.h"
-
 void CSourceGenerator::visit(InterfaceNode &node)
 {
-    macro_interface_name = node.name;
-    std::transform(
-        macro_interface_name.begin(),
-        macro_interface_name.end(),
-        macro_interface_name.begin(),
-        ::toupper
-    );
-
-    for (const auto &anno : node.annotations) {
-        if (anno->name == "prefix") {
-            if (anno->args.size() != 1) {
-                throw std::runtime_error("Invalid argument size");
-            }
-
-            auto prefix_param = dynamic_cast<StringLiteralExpressionNode *>(anno->args[0].get());
-            if (!prefix_param) {
-                throw std::runtime_error("Invalid argument type");
-            }
-
-            prefix = prefix_param->value.substr(1, prefix_param->value.size() - 2);
-        }
-    }
+    parse_interface_annotations(node);
 
     for (const auto &group : node.groups) {
         group->accept(*this);
     }
 
     out << "/* =====================================================================\n";
-    out << " * Auto-generated by sidlc v" << SIDLC_VERSION << " (" << SIDLC_GIT_HASH << ")\n";
+    out << " * Auto-generated by " << generated_by() << "\n";
     out << " * Target Interface: " << node.name << "\n";
     out << " * DO NOT EDIT THIS FILE MANUALLY!\n";
     out << " * ===================================================================== */\n\n";
 
+    // Interfaces without functions have nothing to instrument
+    bool instrument = options.instrument && buf_stats_names.tellp() > 0;
+
+    // clock_gettime() is POSIX, which strict ISO C modes leave undeclared
+    if (instrument) {
+        out << "#if defined(__STRICT_ANSI__) && !defined(_POSIX_C_SOURCE)\n";
+        out << "#define _POSIX_C_SOURCE 199309L\n";
+        out << "#endif\n\n";
+    }
+
     out << "#include \"" << header_name << "\"\n\n";
-    out << "#include <stdint.h>\n\n";
+    out << "#include <stdint.h>\n";
+    if (has_inline_arrays) {
+        out << "#include <string.h>\n";
+    }
+    out << "\n";
     out << "#include <strata/status.h>\n";
     out << "#include <strata/macros.h>\n";
-    out << "#include <strata/uuid.h>\n\n";
+    out << "#include <strata/uuid.h>\n";
+    if (has_shared) {
+        out << "#include <strata/shm.h>\n";
+    }
+    out << "\n";
+
+    if (options.funcid_cache || has_async || instrument) {
+        out << "#include <stdatomic.h>\n";
+    }
+    if (options.batch) {
+        out << "#include <stddef.h>\n";
+    }
+    if (instrument) {
+        out << "#include <inttypes.h>\n";
+        out << "#include <stdio.h>\n";
+        out << "#include <stdlib.h>\n";
+        out << "#include <string.h>\n";
+        out << "#include <time.h>\n";
+    }
+    if (options.usdt && !options.inline_stubs) {
+        out << "#include <sys/sdt.h>\n";
+    }
+    if (options.funcid_cache || options.batch || has_async || instrument ||
+        (options.usdt && !options.inline_stubs)) {
+        out << "\n";
+    }
 
-    if (buf_macros.tellp() > 0) {
-        out << "/* Constants & Bitmasks */\n";
-        out << buf_macros.str() << "\n";
+    // With --inline-stubs the uuid, cache entry and query helper live in the header
+    if (!options.inline_stubs) {
+        out << "static const struct StUuid interface_uuid = "
+            << "UUID_" << macro_interface_name << "_INTERFACE_INIT;\n\n";
     }
 
-    out << "static const struct StUuid interface_uuid = "
-        << "UUID_" << macro_interface_name << "_INTERFACE_INIT;\n\n";
+    if (options.funcid_cache) {
+        std::string epochs = stub_name("funcid_cache_epoch") + "[" +
+            stub_name("FUNCID_CACHE_SIZE") + "]";
+
+        // A handle's entries sit in the same slot on every thread and are only trusted while
+        // they carry that slot's epoch, so bumping it drops the handle's cached bases everywhere
+        // without touching other threads' storage. Handles sharing the slot are queried again.
+        out << "/* Function ID Cache */\n";
+        if (!options.inline_stubs) {
+            emit_funcid_cache_entry(out);
+        }
+        out << (options.inline_stubs ? "" : "static ") << "_Atomic uint32_t " << epochs << " = {";
+        for (size_t i = 0; i < funcid_cache_size; ++i) {
+            out << (i == 0 ? " " : ", ") << "1";
+        }
+        out << " };\n";
+        out << buf_cache.str() << "\n";
+        if (!options.inline_stubs) {
+            emit_funcid_cache_query(out);
+        }
+        out << "void " << prefix << "InvalidateFuncidCache(StHandle handle __in)\n";
+        out << "{\n";
+        out << "    atomic_fetch_add_explicit(&" << stub_name("funcid_cache_epoch")
+            << "[(unsigned long)handle % " << stub_name("FUNCID_CACHE_SIZE")
+            << "], 1, memory_order_release);\n";
+        out << "}\n\n";
+    }
 
-    if (buf_functions.tellp() > 0) {
+    if (instrument) {
+        emit_instrumentation();
+    }
+
+    if (!options.inline_stubs && buf_functions.tellp() > 0) {
         out << "/* Functions & Views */\n";
         out << buf_functions.str() << "\n";
     }
+
+    if (buf_negotiate_body.tellp() > 0) {
+        std::string client_type = prefix + "Client";
+
+        out << "/* Negotiation */\n";
+        out << buf_negotiate.str();
+        out << "StStatus " << prefix << "Negotiate(" << client_type
+            << " *client __out, StHandle handle __in)\n";
+        out << "{\n";
+        out << "    StStatus status = STATUS_NOT_SUPPORTED;\n";
+        out << "    uint32_t funcid_base;\n";
+        out << "    uint32_t i;\n";
+        out << "    int supported = 0;\n";
+        out << "    client->handle = handle;\n";
+        out << buf_negotiate_body.str();
+        out << "    return supported ? STATUS_SUCCESS : status;\n";
+        out << "}\n\n";
+    }
+
+    if (options.batch) {
+        std::string batch_type = prefix + "Batch";
+
+        out << "/* Batching */\n";
+        out << "struct BatchFixup {\n";
+        out << "    void (*unpack)(const void *out_block, void *const *dst);\n";
+        out << "    void *out;\n";
+        out << "    void *dst[];\n";
+        out << "};\n\n";
+        out << "static void *batch_alloc(" << batch_type << " *batch, size_t size)\n";
+        out << "{\n";
+        out << "    uintptr_t base = (uintptr_t)batch->arena;\n";
+        out << "    uintptr_t align = _Alignof(max_align_t);\n";
+        out << "    size_t offset = ((base + batch->arena_used + align - 1) & ~(align - 1)) - base;\n";
+        out << "    if (offset > batch->arena_size || size > batch->arena_size - offset) "
+               "{ return NULL; }\n";
+        out << "    batch->arena_used = offset + size;\n";
+        out << "    return batch->arena + offset;\n";
+        out << "}\n\n";
+        out << "void " << prefix << "BatchBegin(" << batch_type
+            << " *batch __out, struct StHandleCallDesc *descs __in, size_t capacity __in, "
+               "void *arena __in, size_t arena_size __in)\n";
+        out << "{\n";
+        if (n_batch_bases != 0) {
+            out << "    size_t i;\n";
+        }
+        out << "    batch->descs = descs;\n";
+        out << "    batch->count = 0;\n";
+        out << "    batch->capacity = capacity;\n";
+        out << "    batch->arena = arena;\n";
+        out << "    batch->arena_used = 0;\n";
+        out << "    batch->arena_size = arena_size;\n";
+        if (n_batch_bases != 0) {
+            out << "    for (i = 0; i < sizeof(batch->bases) / sizeof(batch->bases[0]); i++) "
+                   "{ batch->bases[i].count = 0; }\n";
+        }
+        out << "}\n\n";
+        out << "StStatus " << prefix << "BatchSubmit(" << batch_type << " *batch __inout)\n";
+        out << "{\n";
+        out << "    StStatus status;\n";
+        out << "    size_t i;\n";
+        out << "    if (batch->count == 0) { return STATUS_SUCCESS; }\n";
+        out << "    status = StHandle_CallBatch(batch->descs, batch->count);\n";
+        out << "    if (!CHECK_SUCCESS(status)) { return status; }\n";
+        out << "    for (i = 0; i < batch->count; i++) {\n";
+        out << "        const struct StHandleCallDesc *desc = &batch->descs[i];\n";
+        out << "        const struct BatchFixup *fixup = "
+               "(const struct BatchFixup *)(uintptr_t)desc->user_data;\n";
+        out << "        if (fixup != NULL && CHECK_SUCCESS(desc->status)) "
+               "{ fixup->unpack(fixup->out, fixup->dst); }\n";
+        out << "    }\n";
+        out << "    return STATUS_SUCCESS;\n";
+        out << "}\n\n";
+        out << buf_batch.str();
+    }
+
+    if (has_async) {
+        std::string ring_type = prefix + "Ring";
+        std::string ring_entry = prefix + "RingEntry";
+
+        // Single-producer/single-consumer rings: the client owns sq_tail and cq_head, the server
+        // owns sq_head and cq_tail.
+        out << "/* Async Rings */\n";
+        out << "StStatus " << prefix << "RingInit(" << ring_type
+            << " *ring __out, StHandle handle __in, " << ring_entry
+            << " *sq __in, struct StHandleCompletion *cq __in, uint32_t entries __in)\n";
+        out << "{\n";
+        out << "    if (entries == 0 || (entries & (entries - 1)) != 0) "
+               "{ return STATUS_INVALID_ARGUMENT; }\n";
+        out << "    ring->ring.handle = handle;\n";
+        out << "    ring->ring.entries = entries;\n";
+        out << "    ring->ring.sqe_size = sizeof(" << ring_entry << ");\n";
+        out << "    ring->ring.sq = sq;\n";
+        out << "    ring->ring.cq = cq;\n";
+        out << "    atomic_init(&ring->ring.sq_head, 0);\n";
+        out << "    atomic_init(&ring->ring.sq_tail, 0);\n";
+        out << "    atomic_init(&ring->ring.cq_head, 0);\n";
+        out << "    atomic_init(&ring->ring.cq_tail, 0);\n";
+        // A revision the handle does not implement only fails the submissions that need it
+        for (size_t i = 0; i < ring_abis.size(); ++i) {
+            out << "    ring->bases[" << i << "].status = StHandle_Query(handle, &"
+                << stub_name("interface_uuid") << ", " << ring_abis[i]->group.id << ", "
+                << ring_abis[i]->version << ", &ring->bases[" << i << "].funcid_base, NULL);\n";
+        }
+        out << "    return StHandle_RingAttach(handle, &ring->ring);\n";
+        out << "}\n\n";
+        out << "StStatus " << prefix << "RingDoorbell(" << ring_type << " *ring __inout)\n";
+        out << "{\n";
+        out << "    return StHandle_RingDoorbell(ring->ring.handle, &ring->ring);\n";
+        out << "}\n\n";
+        out << "uint32_t " << prefix << "Reap(" << ring_type
+            << " *ring __inout, struct StHandleCompletion *cqes __out, uint32_t max_cqes __in)\n";
+        out << "{\n";
+        out << "    uint32_t head = atomic_load_explicit(&ring->ring.cq_head, "
+               "memory_order_relaxed);\n";
+        out << "    uint32_t tail = atomic_load_explicit(&ring->ring.cq_tail, "
+               "memory_order_acquire);\n";
+        out << "    uint32_t count = tail - head;\n";
+        out << "    uint32_t i;\n";
+        out << "    if (count > max_cqes) { count = max_cqes; }\n";
+        out << "    for (i = 0; i < count; i++) "
+               "{ cqes[i] = ring->ring.cq[(head + i) & (ring->ring.entries - 1)]; }\n";
+        out << "    atomic_store_explicit(&ring->ring.cq_head, head + count, "
+               "memory_order_release);\n";
+        out << "    return count;\n";
+        out << "}\n\n";
+        out << buf_ring.str();
+    }
 }
 
 void CSourceGenerator::visit(GroupNode &node)
 {
-    buf_macros << "\n/* Group " << node.name << " */\n";
     buf_functions << "\n/* Group " << node.name << " */\n";
     for (const auto &abi : node.abiversions) {
         abi->accept(*this);
     }
-}
 
-void CSourceGenerator::visit(AbiversionNode &node)
-{
-    if (!node.functions.empty()) {
-        buf_macros << "\n/* ABI Version " << node.version << " */\n";
-        buf_functions << "\n/* ABI Version " << node.version << " */\n";
+    if (options.negotiate) {
+        emit_negotiate_tables(node);
     }
+}
 
-    for (const auto &f : node.functions) {
-        f->accept(*this);
+void CSourceGenerator::emit_unsupported(FunctionNode &node)
+{
+    buf_negotiate << "static StStatus unsupported_" << node.name << "(const struct " << prefix
+                  << "Client *client __in";
+    emit_params(buf_negotiate, node);
+    buf_negotiate << ")\n";
+    buf_negotiate << "{\n";
+    buf_negotiate << "    (void)client;\n";
+    for (const auto &param : node.parameters) {
+        buf_negotiate << "    (void)_" << param->name << ";\n";
     }
+    buf_negotiate << "    return STATUS_NOT_SUPPORTED;\n";
+    buf_negotiate << "}\n\n";
 }
 
-void CSourceGenerator::visit(FunctionNode &node)
+void CSourceGenerator::emit_negotiate_tables(GroupNode &node)
 {
-    buf_macros << "#define FUNCID_" << node.name << " " << node.id << "\n";
+    std::vector<AbiversionNode *> revisions;
+    bool has_functions = false;
 
-    if (make_weak_symbols) {
-        buf_functions << "__attribute__((weak))\n";
+    for (const auto &abi : node.abiversions) {
+        revisions.push_back(abi);
+        has_functions = has_functions || !abi->functions.empty();
     }
-    if (node.parameters.empty()) {
-        buf_functions << "StStatus " << prefix << node.name << "(StHandle handle __in";
-    } else {
-        buf_functions << "StStatus " << prefix << node.name << "(StHandle handle __in, ";
+    if (!has_functions) {
+        return;
     }
 
-    for (const auto &param : node.parameters) {
-        bool add_pointer = param->direction != ParameterNode::Direction::IN;
-
-        if (param->type->is_ptr) {
-            buf_functions << to_c_type(prefix, *param->type) << (add_pointer ? "*_" : "_")
-                          << param->name;
-        } else {
-            buf_functions << to_c_type(prefix, *param->type) << (add_pointer ? " *_" : " _")
-                          << param->name;
-        }
-
-        switch (param->direction) {
-        case ParameterNode::Direction::IN:
-            buf_functions << " __in";
-            break;
-        case ParameterNode::Direction::OUT:
-            buf_functions << " __out";
-            break;
-        case ParameterNode::Direction::INOUT:
-            buf_functions << " __inout";
-            break;
+    // Newest first, so the first revision the handle accepts wins
+    std::sort(revisions.begin(), revisions.end(), [](AbiversionNode *a, AbiversionNode *b) {
+        return a->version > b->version;
+    });
+
+    std::string ops_type = "struct " + prefix + std::string(node.name) + "_Ops";
+    std::string table_prefix = "negotiated_ops_" + std::to_string(node.id);
+    std::string versions_name = "negotiated_versions_" + std::to_string(node.id);
+
+    auto emit_table = [&](const std::string &name, uint64_t max_version, bool supported) {
+        buf_negotiate << "static const " << ops_type << " " << name << " = {\n";
+        for (const auto &abi : node.abiversions) {
+            for (const auto &f : abi->functions) {
+                bool available = supported && abi->version <= max_version;
+                buf_negotiate << "    ." << f->name << " = "
+                              << (available ? "negotiated_" : "unsupported_") << f->name << ",\n";
+            }
         }
+        buf_negotiate << "};\n\n";
+    };
 
-        if (&param != &node.parameters.back()) {
-            buf_functions << ", ";
-        }
+    for (const auto &abi : revisions) {
+        emit_table(table_prefix + "_" + std::to_string(abi->version), abi->version, true);
     }
+    emit_table(table_prefix + "_none", 0, false);
 
-    buf_functions << ")\n";
+    buf_negotiate << "static const uint64_t " << versions_name << "[] = {";
+    for (size_t i = 0; i < revisions.size(); ++i) {
+        buf_negotiate << (i == 0 ? " " : ", ") << revisions[i]->version;
+    }
+    buf_negotiate << " };\n";
+    buf_negotiate << "static const " << ops_type << " *const " << table_prefix << "[] = {";
+    for (size_t i = 0; i < revisions.size(); ++i) {
+        buf_negotiate << (i == 0 ? " &" : ", &") << table_prefix << "_" << revisions[i]->version;
+    }
+    buf_negotiate << " };\n\n";
+
+    std::string member = "client->" + std::string(node.name);
+    buf_negotiate_body << "    " << member << ".ops = &" << table_prefix << "_none;\n";
+    buf_negotiate_body << "    " << member << ".version = 0;\n";
+    buf_negotiate_body << "    " << member << ".funcid_base = 0;\n";
+    buf_negotiate_body << "    for (i = 0; i < sizeof(" << versions_name << ") / sizeof("
+                       << versions_name << "[0]); i++) {\n";
+    buf_negotiate_body << "        status = StHandle_Query(handle, &" << stub_name("interface_uuid")
+                       << ", " << node.id << ", " << versions_name
+                       << "[i], &funcid_base, NULL);\n";
+    buf_negotiate_body << "        if (CHECK_SUCCESS(status)) {\n";
+    buf_negotiate_body << "            " << member << ".ops = " << table_prefix << "[i];\n";
+    buf_negotiate_body << "            " << member << ".version = " << versions_name << "[i];\n";
+    buf_negotiate_body << "            " << member << ".funcid_base = funcid_base;\n";
+    buf_negotiate_body << "            supported = 1;\n";
+    buf_negotiate_body << "            break;\n";
+    buf_negotiate_body << "        }\n";
+    buf_negotiate_body << "    }\n";
+}
 
-    bool can_use_call_reg = true;
-    size_t k_base = 2;
-    size_t n_avail = g_current_arch_abi->max_reg_args - k_base;
-    size_t k_peel = n_avail > 2 ? n_avail - 2 : 0;
+void CSourceGenerator::visit(AbiversionNode &node)
+{
+    if (!node.functions.empty()) {
+        n_batch_bases++;
+        buf_functions << "\n/* ABI Version " << node.version << " */\n";
 
-    if (node.parameters.size() > n_avail) {
-        can_use_call_reg = false;
+        if (options.funcid_cache) {
+            buf_cache << (options.inline_stubs ? "" : "static ") << "_Thread_local struct "
+                      << stub_name("FuncidCacheEntry") << " " << stub_name("funcid_cache_")
+                      << node.group.id << "_" << node.version << "["
+                      << stub_name("FUNCID_CACHE_SIZE") << "];\n";
+        }
     }
 
-    std::vector<ParameterNode *> peeled_params;
-    std::vector<ParameterNode *> packed_in_params;
-    std::vector<ParameterNode *> packed_out_params;
-
-    for (const auto &param : node.parameters) {
-        bool is_scalar = param->direction == ParameterNode::Direction::IN && !param->type->is_ptr &&
-            !param->type->is_array && param->type->type_size <= g_current_arch_abi->pointer_size;
+    for (const auto &f : node.functions) {
+        f->accept(*this);
+    }
+}
 
-        if (!is_scalar) {
-            can_use_call_reg = false;
-        }
+void CSourceGenerator::emit_batch(FunctionNode &node, const CallShape &shape)
+{
+    const auto &packed_in_params = shape.packed_in_params;
+    const auto &packed_out_params = shape.packed_out_params;
+    const auto &reg_out_params = shape.reg_out_params;
+    std::string batch_type = prefix + "Batch";
+
+    // Multiple out values, and register returns, land in an arena copy of the out block and are
+    // scattered to the caller's pointers by this function once the batch completes.
+    std::vector<ParameterNode *> fixup_params;
+    if (!reg_out_params.empty()) {
+        fixup_params = reg_out_params;
+    } else if (!shape.use_call_reg && packed_out_params.size() > 1) {
+        fixup_params = packed_out_params;
+    }
 
-        if (param->direction == ParameterNode::Direction::OUT) {
-            packed_out_params.push_back(param.get());
+    if (!fixup_params.empty()) {
+        buf_batch << "static void batch_unpack_" << node.name
+                  << "(const void *out_block, void *const *dst)\n";
+        buf_batch << "{\n";
+        if (!reg_out_params.empty()) {
+            buf_batch << "    const unsigned long *rets = out_block;\n";
         } else {
-            if (is_scalar && peeled_params.size() < k_peel) {
-                peeled_params.push_back(param.get());
+            buf_batch << "    const struct " << prefix << node.name << "_Out *out = out_block;\n";
+        }
+        for (size_t i = 0; i < fixup_params.size(); ++i) {
+            auto param = fixup_params[i];
+            std::string dst_type = value_decl(*param->type, "*");
+            buf_batch << "    if (dst[" << i << "] != NULL) { *(" << dst_type << ")dst[" << i
+                      << "] = ";
+            if (!reg_out_params.empty()) {
+                buf_batch << "(" << to_c_type(prefix, *param->type) << ")rets[" << i << "]; }\n";
             } else {
-                packed_in_params.push_back(param.get());
+                buf_batch << "out->" << param->name << "; }\n";
             }
         }
+        buf_batch << "}\n\n";
     }
 
-    buf_functions << "{\n";
-    buf_functions << "    StStatus status;\n";
-    buf_functions << "    uint32_t funcid_base;\n";
+    if (options.make_weak_symbols) {
+        buf_batch << "__attribute__((weak))\n";
+    }
+    buf_batch << "StStatus " << prefix << "Batch_" << node.name << "(" << batch_type
+              << " *batch __inout, StHandle handle __in";
+    emit_params(buf_batch, node);
+    buf_batch << ")\n";
+
+    buf_batch << "{\n";
+    buf_batch << "    StStatus status;\n";
+    buf_batch << "    uint32_t funcid_base;\n";
+    buf_batch << "    uint32_t slot;\n";
+    buf_batch << "    struct StHandleCallDesc *desc;\n";
+    if (!shape.use_call_reg && packed_in_params.size() > 1) {
+        buf_batch << "    struct " << prefix << node.name << "_In *in;\n";
+    } else if (!shape.use_call_reg && packed_in_params.size() == 1 &&
+               !wire_is_ptr(*packed_in_params.front())) {
+        buf_batch << "    " << wire_decl(*packed_in_params.front(), "*in") << ";\n";
+    }
+    if (!fixup_params.empty()) {
+        buf_batch << "    struct BatchFixup *fixup;\n";
+    } else if (!shape.use_call_reg && packed_out_params.size() == 1 &&
+               !packed_out_params.front()->type->is_ptr) {
+        buf_batch << "    void *out = _" << packed_out_params.front()->name << ";\n";
+    }
 
-    if (!can_use_call_reg && !packed_in_params.empty()) {
+    emit_shared_decls(buf_batch, node);
+
+    buf_batch << "    if (batch->count == batch->capacity) { return STATUS_NO_MEMORY; }\n";
+    emit_length_checks(buf_batch, node);
+
+    // Only the first call recorded for this revision and handle pays for a query; past
+    // batch_handles handles, the handle's slot is reused
+    std::string base = "batch->bases[" + std::to_string(n_batch_bases - 1) + "]";
+    buf_batch << "    for (slot = 0; slot < " << base << ".count; slot++) {\n";
+    buf_batch << "        if (" << base << ".slots[slot].handle == handle) { break; }\n";
+    buf_batch << "    }\n";
+    buf_batch << "    if (slot == " << base << ".count) {\n";
+    emit_query(buf_batch, node, "        ");
+    buf_batch << "        if (" << base << ".count < " << batch_handles << ") { " << base
+              << ".count++; } else { slot = handle % " << batch_handles << "; }\n";
+    buf_batch << "        " << base << ".slots[slot].handle = handle;\n";
+    buf_batch << "        " << base << ".slots[slot].funcid_base = funcid_base;\n";
+    buf_batch << "    }\n";
+    buf_batch << "    funcid_base = " << base << ".slots[slot].funcid_base;\n";
+    emit_shared_offsets(buf_batch, node);
+
+    if (!shape.use_call_reg && !packed_in_params.empty()) {
         if (packed_in_params.size() > 1) {
-            buf_functions << "    struct {\n";
-            for (const auto &param : packed_in_params) {
-                switch (param->direction) {
-                case ParameterNode::Direction::IN:
-                    if (param->type->is_ptr) {
-                        buf_functions << "        " << to_c_type(prefix, *param->type)
-                                      << param->name << ";\n";
-                    } else {
-                        buf_functions << "        " << to_c_type(prefix, *param->type) << " "
-                                      << param->name << ";\n";
-                    }
-                    break;
-                case ParameterNode::Direction::INOUT:
-                    if (param->type->is_ptr) {
-                        buf_functions << "        " << to_c_type(prefix, *param->type) << "*"
-                                      << param->name << ";\n";
-                    } else {
-                        buf_functions << "        " << to_c_type(prefix, *param->type) << " *"
-                                      << param->name << ";\n";
-                    }
-                    break;
-                case ParameterNode::Direction::OUT:
-                    break;
-                }
-            }
-            buf_functions << "    } __packed in = {\n";
+            buf_batch << "    in = batch_alloc(batch, sizeof(*in));\n";
+            buf_batch << "    if (in == NULL) { return STATUS_NO_MEMORY; }\n";
             for (const auto &param : packed_in_params) {
-                if (param->type->is_ptr) {
-                    buf_functions << "        ." << param->name << " = _" << param->name << ",\n";
-                } else {
-                    buf_functions << "        ." << param->name << " = _" << param->name << ",\n";
-                }
+                buf_batch << "    in->" << param->name << " = " << wire_value(*param) << ";\n";
             }
-            buf_functions << "    };\n";
+        } else if (!wire_is_ptr(*packed_in_params.front())) {
+            buf_batch << "    in = batch_alloc(batch, sizeof(*in));\n";
+            buf_batch << "    if (in == NULL) { return STATUS_NO_MEMORY; }\n";
+            buf_batch << "    *in = " << wire_value(*packed_in_params.front()) << ";\n";
         }
     }
-    if (!can_use_call_reg && !packed_out_params.empty()) {
-        if (packed_out_params.size() > 1) {
-            buf_functions << "    struct {\n";
-            for (const auto &param : packed_out_params) {
-                if (param->type->is_ptr) {
-                    buf_functions << "        " << to_c_type(prefix, *param->type) << param->name
-                                  << ";\n";
-                } else {
-                    buf_functions << "        " << to_c_type(prefix, *param->type) << " "
-                                  << param->name << ";\n";
-                }
-            }
-            buf_functions << "    } __packed out;\n";
-        } else if (!packed_out_params.front()->type->is_ptr) {
-            buf_functions << "    " << to_c_type(prefix, *packed_out_params.front()->type)
-                          << " out;\n";
+    if (!fixup_params.empty()) {
+        buf_batch << "    fixup = batch_alloc(batch, sizeof(*fixup) + " << fixup_params.size()
+                  << " * sizeof(void *));\n";
+        buf_batch << "    if (fixup == NULL) { return STATUS_NO_MEMORY; }\n";
+        if (!reg_out_params.empty()) {
+            buf_batch << "    fixup->out = batch_alloc(batch, " << reg_out_params.size()
+                      << " * sizeof(unsigned long));\n";
+        } else {
+            buf_batch << "    fixup->out = batch_alloc(batch, sizeof(struct " << prefix
+                      << node.name << "_Out));\n";
         }
-    }
-    buf_functions << "    status = StHandle_Query("
-                     "handle, &interface_uuid, "
-                  << node.abiversion.group.id << ", " << node.abiversion.version
-                  << ", &funcid_base, NULL);\n";
-    buf_functions << "    if (!CHECK_SUCCESS(status)) { return status; }\n";
-
-    if (can_use_call_reg) {
-        buf_functions << "    status = StHandle_Call" << node.parameters.size()
-                      << "(handle, funcid_base + FUNCID_" << node.name;
-        for (size_t i = 0; i < node.parameters.size(); ++i) {
-            buf_functions << ", (unsigned long)_" << node.parameters[i]->name;
+        buf_batch << "    if (fixup->out == NULL) { return STATUS_NO_MEMORY; }\n";
+        buf_batch << "    fixup->unpack = batch_unpack_" << node.name << ";\n";
+        for (size_t i = 0; i < fixup_params.size(); ++i) {
+            buf_batch << "    fixup->dst[" << i << "] = _" << fixup_params[i]->name << ";\n";
         }
-        buf_functions << ");\n";
+    } else if (!shape.use_call_reg && packed_out_params.size() == 1 &&
+               !packed_out_params.front()->type->is_ptr) {
+        // A single out value is written straight into the caller's storage.
+        buf_batch << "    if (out == NULL) {\n";
+        buf_batch << "        out = batch_alloc(batch, sizeof(*_"
+                  << packed_out_params.front()->name << "));\n";
+        buf_batch << "        if (out == NULL) { return STATUS_NO_MEMORY; }\n";
+        buf_batch << "    }\n";
+    }
+
+    buf_batch << "    desc = &batch->descs[batch->count];\n";
+    buf_batch << "    desc->handle = handle;\n";
+    buf_batch << "    desc->funcid = funcid_base + " << funcid_macro(node) << ";\n";
+    // Queued calls keep passing array pointers, so nothing follows the in block
+    buf_batch << "    desc->in_size = 0;\n";
+
+    size_t n_args = 0;
+    if (shape.use_call_reg) {
+        buf_batch << "    desc->in = NULL;\n";
+        buf_batch << "    desc->out = " << (reg_out_params.empty() ? "NULL" : "fixup->out") << ";\n";
     } else {
-        buf_functions << "    status = StHandle_CallN(handle, funcid_base + FUNCID_" << node.name
-                      << ", ";
-        if (!packed_in_params.empty()) {
-            if (packed_in_params.size() == 1) {
-                if (packed_in_params.front()->type->is_ptr) {
-                    buf_functions << "(const void *)_" << packed_in_params.front()->name << ", ";
-                } else {
-                    buf_functions << "(const void *)&_" << packed_in_params.front()->name << ", ";
-                }
-            } else {
-                buf_functions << "(const void *)&in, ";
-            }
+        if (packed_in_params.empty()) {
+            buf_batch << "    desc->in = NULL;\n";
+        } else if (packed_in_params.size() == 1 && wire_is_ptr(*packed_in_params.front())) {
+            buf_batch << "    desc->in = (const void *)_" << packed_in_params.front()->name
+                      << ";\n";
         } else {
-            buf_functions << "NULL, ";
+            buf_batch << "    desc->in = in;\n";
         }
-        if (!packed_out_params.empty()) {
-            if (packed_out_params.size() == 1) {
-                if (packed_out_params.front()->type->is_ptr) {
-                    buf_functions << "(void *)_" << packed_out_params.front()->name << ", ";
-                } else {
-                    buf_functions << "(void *)&out, ";
-                }
-            } else {
-                buf_functions << "(void *)&out, ";
-            }
+        if (packed_out_params.empty()) {
+            buf_batch << "    desc->out = NULL;\n";
+        } else if (packed_out_params.size() == 1 && packed_out_params.front()->type->is_ptr) {
+            buf_batch << "    desc->out = (void *)_" << packed_out_params.front()->name << ";\n";
+        } else if (packed_out_params.size() == 1) {
+            buf_batch << "    desc->out = out;\n";
         } else {
-            buf_functions << "NULL, ";
+            buf_batch << "    desc->out = fixup->out;\n";
         }
-        for (size_t i = 0; i < k_peel; ++i) {
-            if (i < peeled_params.size()) {
-                buf_functions << "(unsigned long)_" << peeled_params[i]->name;
-            } else {
-                buf_functions << "0";
-            }
-            if (i < k_peel - 1) {
-                buf_functions << ", ";
+    }
+    for (const auto &word : shape.reg_words) {
+        buf_batch << "    desc->args[" << n_args++ << "] = " << reg_word_value(word) << ";\n";
+    }
+    if (!fixup_params.empty()) {
+        buf_batch << "    desc->user_data = (uint64_t)(uintptr_t)fixup;\n";
+    } else {
+        buf_batch << "    desc->user_data = 0;\n";
+    }
+    buf_batch << "    desc->status = STATUS_SUCCESS;\n";
+    buf_batch << "    batch->count++;\n";
+    buf_batch << "    return STATUS_SUCCESS;\n";
+    buf_batch << "}\n\n";
+}
+
+void CSourceGenerator::emit_submit(FunctionNode &node, const CallShape &shape)
+{
+    const auto &packed_in_params = shape.packed_in_params;
+    const auto &packed_out_params = shape.packed_out_params;
+    std::string ring_entry = prefix + "RingEntry";
+    std::string member = async_in_member(node, shape);
+
+    std::string base = "ring->bases[" + std::to_string(ring_base(node)) + "]";
+    bool has_shared_params = std::any_of(
+        node.parameters.begin(), node.parameters.end(), [&](auto &p) { return is_shared(*p); }
+    );
+
+    if (options.make_weak_symbols) {
+        buf_ring << "__attribute__((weak))\n";
+    }
+    buf_ring << "StStatus " << prefix << "Submit_" << node.name << "(" << prefix
+             << "Ring *ring __inout, uint64_t user_data __in";
+    emit_params(buf_ring, node);
+    buf_ring << ")\n";
+
+    buf_ring << "{\n";
+    if (has_shared_params) {
+        buf_ring << "    StStatus status;\n";
+    }
+    buf_ring << "    StHandle handle = ring->ring.handle;\n";
+    buf_ring << "    uint32_t tail = atomic_load_explicit(&ring->ring.sq_tail, "
+                "memory_order_relaxed);\n";
+    buf_ring << "    " << ring_entry << " *sqe;\n";
+    emit_shared_decls(buf_ring, node);
+    if (!packed_out_params.empty() && !packed_out_params.front()->type->is_ptr) {
+        buf_ring << "    if (_" << packed_out_params.front()->name
+                 << " == NULL) { return STATUS_INVALID_ARGUMENT; }\n";
+    }
+    emit_length_checks(buf_ring, node);
+    // The base was resolved once by RingInit, so queueing never crosses the boundary
+    buf_ring << "    if (!CHECK_SUCCESS(" << base << ".status)) { return " << base
+             << ".status; }\n";
+    buf_ring << "    if (tail - atomic_load_explicit(&ring->ring.sq_head, memory_order_acquire) == "
+                "ring->ring.entries) { return STATUS_BUSY; }\n";
+    emit_shared_offsets(buf_ring, node);
+    buf_ring << "    sqe = &((" << ring_entry
+             << " *)ring->ring.sq)[tail & (ring->ring.entries - 1)];\n";
+
+    if (!member.empty()) {
+        if (packed_in_params.size() > 1) {
+            for (const auto &param : packed_in_params) {
+                buf_ring << "    sqe->in." << node.name << "." << param->name << " = "
+                         << wire_value(*param) << ";\n";
             }
+        } else {
+            buf_ring << "    sqe->in." << node.name << " = "
+                     << wire_value(*packed_in_params.front()) << ";\n";
         }
-        buf_functions << ");\n";
     }
-    buf_functions << "    if (!CHECK_SUCCESS(status)) { return status; }\n";
 
-    if (!can_use_call_reg && !packed_out_params.empty()) {
-        if (packed_out_params.size() == 1) {
-            auto param = packed_out_params.front();
-            if (!param->type->is_ptr) {
-                buf_functions << "    if (_" << param->name << " != NULL) "
-                              << "{ *_" << param->name << " = out; }\n";
-            }
+    buf_ring << "    sqe->desc.handle = handle;\n";
+    buf_ring << "    sqe->desc.funcid = " << base << ".funcid_base + " << funcid_macro(node) << ";\n";
+    buf_ring << "    sqe->desc.in_size = 0;\n";
+
+    size_t n_args = 0;
+    if (shape.use_call_reg) {
+        buf_ring << "    sqe->desc.in = NULL;\n";
+        buf_ring << "    sqe->desc.out = NULL;\n";
+    } else {
+        if (!member.empty()) {
+            buf_ring << "    sqe->desc.in = &sqe->in." << node.name << ";\n";
+        } else if (!packed_in_params.empty()) {
+            buf_ring << "    sqe->desc.in = (const void *)_" << packed_in_params.front()->name
+                     << ";\n";
         } else {
-            for (const auto &param : packed_out_params) {
-                buf_functions << "    if (_" << param->name << " != NULL) "
-                              << "{ *_" << param->name << " = out." << param->name << "; }\n";
-            }
+            buf_ring << "    sqe->desc.in = NULL;\n";
+        }
+        if (!packed_out_params.empty()) {
+            buf_ring << "    sqe->desc.out = (void *)_" << packed_out_params.front()->name << ";\n";
+        } else {
+            buf_ring << "    sqe->desc.out = NULL;\n";
         }
     }
+    for (const auto &word : shape.reg_words) {
+        buf_ring << "    sqe->desc.args[" << n_args++ << "] = " << reg_word_value(word) << ";\n";
+    }
+    buf_ring << "    sqe->desc.user_data = user_data;\n";
+    buf_ring << "    sqe->desc.status = STATUS_SUCCESS;\n";
+    buf_ring << "    atomic_store_explicit(&ring->ring.sq_tail, tail + 1, memory_order_release);\n";
+    buf_ring << "    return STATUS_SUCCESS;\n";
+    buf_ring << "}\n\n";
+}
 
-    buf_functions << "    return STATUS_SUCCESS;\n";
-    buf_functions << "}\n\n";
+void CSourceGenerator::emit_instrumentation()
+{
+    std::string stats_type = prefix + "FunctionStats";
+    std::string count = macro_interface_name + "_STATS_COUNT";
+    std::string buckets = macro_interface_name + "_STATS_BUCKETS";
+
+    // Slots are only ever written by their own thread, so plain loads and stores of relaxed
+    // atomics are enough; each slot gets its own cache line to keep threads from sharing them.
+    out << "/* Instrumentation */\n";
+    out << "struct StatsSlot {\n";
+    out << "    _Alignas(64) _Atomic uint64_t calls;\n";
+    out << "    _Atomic uint64_t errors;\n";
+    out << "    _Atomic uint64_t latency[" << buckets << "];\n";
+    out << "};\n\n";
+    out << "struct StatsThread {\n";
+    out << "    struct StatsSlot slots[" << count << "];\n";
+    out << "    struct StatsThread *next;\n";
+    out << "};\n\n";
+    out << "static const char *const stats_names[" << count << "] = {\n";
+    out << buf_stats_names.str();
+    out << "};\n\n";
+    out << "static _Atomic(struct StatsThread *) stats_threads;\n";
+    out << "static _Thread_local struct StatsThread *stats_thread;\n\n";
+
+    if (!options.inline_stubs) {
+        emit_stats_now(out);
+    }
+
+    // A thread's slots outlive it so that its calls still show up in the totals
+    out << "static struct StatsThread *stats_register(void)\n";
+    out << "{\n";
+    out << "    struct StatsThread *thread = aligned_alloc(_Alignof(struct StatsThread), "
+           "sizeof(*thread));\n";
+    out << "    if (thread == NULL) { return NULL; }\n";
+    out << "    memset(thread, 0, sizeof(*thread));\n";
+    out << "    thread->next = atomic_load_explicit(&stats_threads, memory_order_relaxed);\n";
+    out << "    while (!atomic_compare_exchange_weak_explicit(&stats_threads, &thread->next, "
+           "thread, memory_order_release, memory_order_relaxed)) {\n";
+    out << "    }\n";
+    out << "    stats_thread = thread;\n";
+    out << "    return thread;\n";
+    out << "}\n\n";
+
+    out << "static inline void stats_add(_Atomic uint64_t *counter)\n";
+    out << "{\n";
+    out << "    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) "
+           "+ 1, memory_order_relaxed);\n";
+    out << "}\n\n";
+
+    out << "void " << prefix
+        << "RecordStats(uint32_t index __in, StStatus status __in, uint64_t start_ns __in)\n";
+    out << "{\n";
+    out << "    struct StatsThread *thread = stats_thread;\n";
+    out << "    struct StatsSlot *slot;\n";
+    out << "    uint64_t elapsed = " << stub_name("stats_now") << "() - start_ns;\n";
+    out << "    uint32_t bucket = elapsed > 1 ? 63 - (uint32_t)__builtin_clzll(elapsed) : 0;\n";
+    out << "    if (thread == NULL && (thread = stats_register()) == NULL) { return; }\n";
+    out << "    if (bucket >= " << buckets << ") { bucket = " << buckets << " - 1; }\n";
+    out << "    slot = &thread->slots[index];\n";
+    out << "    stats_add(&slot->calls);\n";
+    out << "    if (!CHECK_SUCCESS(status)) { stats_add(&slot->errors); }\n";
+    out << "    stats_add(&slot->latency[bucket]);\n";
+    out << "}\n\n";
+
+    out << "void " << prefix << "CollectStats(" << stats_type << " *stats __out)\n";
+    out << "{\n";
+    out << "    const struct StatsThread *thread;\n";
+    out << "    uint32_t i, j;\n";
+    out << "    memset(stats, 0, " << count << " * sizeof(*stats));\n";
+    out << "    for (thread = atomic_load_explicit(&stats_threads, memory_order_acquire); "
+           "thread != NULL; thread = thread->next) {\n";
+    out << "        for (i = 0; i < " << count << "; i++) {\n";
+    out << "            const struct StatsSlot *slot = &thread->slots[i];\n";
+    out << "            stats[i].calls += atomic_load_explicit(&slot->calls, "
+           "memory_order_relaxed);\n";
+    out << "            stats[i].errors += atomic_load_explicit(&slot->errors, "
+           "memory_order_relaxed);\n";
+    out << "            for (j = 0; j < " << buckets << "; j++) {\n";
+    out << "                stats[i].latency[j] += atomic_load_explicit(&slot->latency[j], "
+           "memory_order_relaxed);\n";
+    out << "            }\n";
+    out << "        }\n";
+    out << "    }\n";
+    out << "}\n\n";
+
+    // Percentiles are reported as the upper bound of the bucket they fall into
+    out << "static uint64_t stats_percentile(const " << stats_type
+        << " *stats, uint64_t percent)\n";
+    out << "{\n";
+    out << "    uint64_t rank = (stats->calls * percent + 99) / 100;\n";
+    out << "    uint64_t seen = 0;\n";
+    out << "    uint32_t i;\n";
+    out << "    for (i = 0; i < " << buckets << " - 1; i++) {\n";
+    out << "        seen += stats->latency[i];\n";
+    out << "        if (seen >= rank) { return (uint64_t)2 << i; }\n";
+    out << "    }\n";
+    out << "    return UINT64_MAX;\n";
+    out << "}\n\n";
+
+    out << "void " << prefix << "DumpStats(FILE *stream __in)\n";
+    out << "{\n";
+    out << "    " << stats_type << " stats[" << count << "];\n";
+    out << "    uint32_t i;\n";
+    out << "    " << prefix << "CollectStats(stats);\n";
+    out << "    fprintf(stream, \"%-40s %12s %12s %12s %12s\\n\", \"function\", \"calls\", "
+           "\"errors\", \"p50 ns\", \"p99 ns\");\n";
+    out << "    for (i = 0; i < " << count << "; i++) {\n";
+    out << "        if (stats[i].calls == 0) { continue; }\n";
+    out << "        fprintf(stream, \"%-40s %12\" PRIu64 \" %12\" PRIu64 \" %12\" PRIu64 \" %12\" "
+           "PRIu64 \"\\n\", stats_names[i], stats[i].calls, stats[i].errors, "
+           "stats_percentile(&stats[i], 50), stats_percentile(&stats[i], 99));\n";
+    out << "    }\n";
+    out << "}\n\n";
+}
+
+void CSourceGenerator::visit(FunctionNode &node)
+{
+    CallShape shape = classify(node);
+
+    if (options.instrument) {
+        buf_stats_names << "    [" << stats_macro(node) << "] = \"" << node.abiversion.group.name
+                        << "." << node.name << "\",\n";
+    }
+
+    if (!options.inline_stubs) {
+        emit_stub(buf_functions, node, shape);
+    }
+
+    if (options.negotiate) {
+        emit_stub(buf_negotiate, node, shape, true);
+        emit_unsupported(node);
+    }
+
+    if (options.batch) {
+        emit_batch(node, shape);
+    }
+
+    if (is_async(node)) {
+        has_async = true;
+        emit_submit(node, shape);
+    }
 }
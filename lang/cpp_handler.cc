@@ -0,0 +1,80 @@
+#include <cpp_handler.hh>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ast.hh>
+#include <c_options.hh>
+#include <cpp_header_generator.hh>
+#include <output_file.hh>
+
+// Only the options that change the wire format apply; they have to match the C server's
+static COptions options;
+
+struct CppOutputs : LangOutputs {
+    std::string header_path;
+
+    bool empty() const override { return header_path.empty(); }
+
+    std::vector<LangOutputFile> files() const override
+    {
+        if (header_path.empty()) {
+            return {};
+        }
+        return { { "header", header_path } };
+    }
+
+    std::string fingerprint() const override { return options_fingerprint(options); }
+    bool stable() const override { return options.stable_output; }
+};
+
+static CppOutputs outputs;
+
+static bool handle_generation_option(const std::string &arg)
+{
+    if (arg == "--reg-returns") {
+        options.reg_returns = true;
+        return true;
+    } else if (arg == "--pack-scalars") {
+        options.pack_scalars = true;
+        return true;
+    } else if (arg == "--stable-output") {
+        options.stable_output = true;
+        return true;
+    } else if (arg.rfind("--inline-arrays=", 0) == 0) {
+        return parse_inline_arrays(arg.substr(16), options);
+    } else if (arg == "--layout=packed") {
+        options.layout = CBlockLayout::PACKED;
+        return true;
+    } else if (arg == "--layout=aligned") {
+        options.layout = CBlockLayout::ALIGNED;
+        return true;
+    }
+    return false;
+}
+
+bool cpp_handle_option(const std::string &arg)
+{
+    if (arg.rfind("--header=", 0) == 0) {
+        outputs.header_path = arg.substr(9);
+        return true;
+    }
+    return handle_generation_option(arg);
+}
+
+std::unique_ptr<LangOutputs> cpp_take_outputs()
+{
+    auto taken = std::make_unique<CppOutputs>(std::move(outputs));
+    outputs = CppOutputs();
+    return taken;
+}
+
+bool cpp_generate(InterfaceNode *interface, const LangOutputs &outputs)
+{
+    auto &paths = static_cast<const CppOutputs &>(outputs);
+
+    return generate_output<CppHeaderGenerator>(
+        interface, paths.header_path, options.stable_output, options
+    );
+}
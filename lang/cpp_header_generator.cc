@@ -0,0 +1,849 @@
+#include <cpp_header_generator.hh>
+
+#include <algorithm>
+
+#include <arch_abi.hh>
+#include <ast.hh>
+
+// Shared by every generated header, hence the include guard around it
+static const char *support_code = R"(#ifndef __SIDL_CPP_SUPPORT__
+#define __SIDL_CPP_SUPPORT__
+namespace sidl {
+
+template <typename T>
+constexpr unsigned long word(T value)
+{
+    if constexpr (std::is_pointer_v<T>) {
+        return reinterpret_cast<std::uintptr_t>(value);
+    } else if constexpr (std::is_enum_v<T>) {
+        return static_cast<unsigned long>(static_cast<std::underlying_type_t<T>>(value));
+    } else {
+        return static_cast<unsigned long>(value);
+    }
+}
+
+// Truncated to the field width so sign extension cannot leak into the neighbouring fields
+template <unsigned Bits, typename T>
+constexpr unsigned long field(T value)
+{
+    static_assert(Bits < sizeof(unsigned long) * 8);
+    return word(value) & ((1ul << Bits) - 1);
+}
+
+template <typename T>
+constexpr T unword(unsigned long value)
+{
+    if constexpr (std::is_pointer_v<T>) {
+        return reinterpret_cast<T>(static_cast<std::uintptr_t>(value));
+    } else if constexpr (std::is_enum_v<T>) {
+        return static_cast<T>(static_cast<std::underlying_type_t<T>>(value));
+    } else {
+        return static_cast<T>(value);
+    }
+}
+
+template <typename... Words>
+inline StStatus call(StHandle handle, std::uint32_t funcid, Words... words)
+{
+    static_assert(sizeof...(Words) <= STHANDLE_CALL_MAX_ARGS);
+    if constexpr (sizeof...(Words) == 0) {
+        return StHandle_Call0(handle, funcid);
+    } else if constexpr (sizeof...(Words) == 1) {
+        return StHandle_Call1(handle, funcid, words...);
+    } else if constexpr (sizeof...(Words) == 2) {
+        return StHandle_Call2(handle, funcid, words...);
+    } else if constexpr (sizeof...(Words) == 3) {
+        return StHandle_Call3(handle, funcid, words...);
+    } else {
+        return StHandle_Call4(handle, funcid, words...);
+    }
+}
+
+template <typename... Words>
+inline StStatus call_ret(StHandle handle, std::uint32_t funcid, unsigned long *rets, Words... words)
+{
+    static_assert(sizeof...(Words) <= 3);
+    if constexpr (sizeof...(Words) == 0) {
+        return StHandle_CallR0(handle, funcid, rets);
+    } else if constexpr (sizeof...(Words) == 1) {
+        return StHandle_CallR1(handle, funcid, rets, words...);
+    } else if constexpr (sizeof...(Words) == 2) {
+        return StHandle_CallR2(handle, funcid, rets, words...);
+    } else {
+        return StHandle_CallR3(handle, funcid, rets, words...);
+    }
+}
+
+}  // namespace sidl
+#endif /* __SIDL_CPP_SUPPORT__ */
+)";
+
+static const char *async_support_code = R"(#ifndef __SIDL_CPP_ASYNC_SUPPORT__
+#define __SIDL_CPP_ASYNC_SUPPORT__
+namespace sidl {
+
+// Pushes newly queued ring entries to the server. Every entry has to be completed eventually by
+// handing its completion to sidl::complete(), typically from the executor's event loop; see
+// strata/epoll_executor.h for the Linux stand-in.
+struct Executor {
+    void (*submit)(void *ctx, StHandleRing *ring);
+    void *ctx;
+};
+
+struct Queue {
+    StHandleRing *ring;
+    Executor executor;
+};
+
+// One in-flight call, identified by the user_data of its ring entry
+struct Operation {
+    std::coroutine_handle<> continuation;
+    StStatus status;
+};
+
+inline void complete(std::uint64_t user_data, StStatus status)
+{
+    auto *operation = reinterpret_cast<Operation *>(static_cast<std::uintptr_t>(user_data));
+    operation->status = status;
+    operation->continuation.resume();
+}
+
+// Suspends the caller until the call completes; errors while queueing, e.g. STATUS_BUSY for a
+// full ring, are returned without suspending
+template <typename Submit>
+class Call {
+  public:
+    Call(const Queue &queue, Submit submit) : queue_(queue), submit_(submit) {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> continuation)
+    {
+        operation_.continuation = continuation;
+        operation_.status = submit_(*queue_.ring, reinterpret_cast<std::uintptr_t>(&operation_));
+        if (!CHECK_SUCCESS(operation_.status)) {
+            return false;
+        }
+        // The caller may be resumed before submit() returns, *this must not be touched after it
+        queue_.executor.submit(queue_.executor.ctx, queue_.ring);
+        return true;
+    }
+
+    StStatus await_resume() const noexcept
+    {
+        return operation_.status;
+    }
+
+  private:
+    Queue queue_;
+    Submit submit_;
+    Operation operation_;
+};
+
+// Eagerly started, detached coroutine for driving calls from plain code
+struct Task {
+    struct promise_type {
+        Task get_return_object() noexcept
+        {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+}  // namespace sidl
+#endif /* __SIDL_CPP_ASYNC_SUPPORT__ */
+)";
+
+void CppHeaderGenerator::visit(InterfaceNode &node)
+{
+    parse_interface_annotations(node);
+
+    // Everything lives in the interface's namespace, the C prefix would only get in the way
+    prefix.clear();
+    namespace_name = node.name;
+
+    std::vector<uint8_t> uuid = interface_uuid(node);
+
+    for (const auto &group : node.groups) {
+        group->accept(*this);
+    }
+
+    out << "/* =====================================================================\n";
+    out << " * Auto-generated by " << generated_by() << "\n";
+    out << " * Target Interface: " << node.name << "\n";
+    out << " * DO NOT EDIT THIS FILE MANUALLY!\n";
+    out << " * ===================================================================== */\n\n";
+
+    out << "#ifndef __SIDL_INTERFACE_" << macro_interface_name << "_HPP__\n";
+    out << "#define __SIDL_INTERFACE_" << macro_interface_name << "_HPP__\n\n";
+    out << "#include <cstddef>\n";
+    out << "#include <cstdint>\n";
+    if (has_async) {
+        out << "#include <coroutine>\n";
+        out << "#include <exception>\n";
+    }
+    if (has_inline_arrays) {
+        out << "#include <cstring>\n";
+    }
+    out << "#include <type_traits>\n\n";
+
+    // libstdc++ uses the Strata direction markers as identifiers; keep them out of C++ code
+    out << "#pragma push_macro(\"__in\")\n";
+    out << "#pragma push_macro(\"__out\")\n";
+    out << "#pragma push_macro(\"__inout\")\n";
+    out << "#include <strata/status.h>\n";
+    out << "#include <strata/handle.h>\n";
+    out << "#include <strata/uuid.h>\n";
+    if (has_shared) {
+        out << "#include <strata/shm.h>\n";
+    }
+    out << "#pragma pop_macro(\"__inout\")\n";
+    out << "#pragma pop_macro(\"__out\")\n";
+    out << "#pragma pop_macro(\"__in\")\n\n";
+
+    out << support_code << "\n";
+    if (has_async) {
+        out << async_support_code << "\n";
+    }
+
+    out << "namespace " << namespace_name << " {\n\n";
+
+    out << "/* Constants */\n";
+    if (!uuid.empty()) {
+        out << "inline constexpr StUuid uuid = { {" << std::hex;
+        for (size_t i = 0; i < uuid.size(); i++) {
+            out << " 0x" << static_cast<int>(uuid[i]) << (i < uuid.size() - 1 ? "," : " ");
+        }
+        out << std::dec << "} };\n\n";
+    }
+    out << "namespace groups {\n";
+    for (const auto &group : node.groups) {
+        out << "inline constexpr std::uint32_t " << group->name << " = " << group->id << ";\n";
+    }
+    out << "}  // namespace groups\n\n";
+
+    if (buf_types.tellp() > 0) {
+        out << "/* Types & Structures */\n";
+        out << buf_types.str();
+    }
+
+    out << "/* Functions */\n";
+    out << "namespace functions {\n";
+    out << buf_functions.str();
+    out << "}  // namespace functions\n\n";
+
+    if (buf_blocks.tellp() > 0) {
+        out << "/* Argument Blocks */\n";
+        out << "namespace layout {\n\n";
+        out << buf_blocks.str();
+        out << "}  // namespace layout\n\n";
+    }
+
+    if (has_async) {
+        // Entries carry their own copy of the in block; everything else handed to an awaitable
+        // call has to stay valid until it completes.
+        out << "/* Async Rings */\n";
+        out << "struct RingEntry {\n";
+        out << "    StHandleCallDesc desc;\n";
+        if (buf_ring_members.tellp() > 0) {
+            out << "    union {\n";
+            out << buf_ring_members.str();
+            out << "    } in;\n";
+        }
+        out << "};\n\n";
+        out << "inline StStatus ring_init(StHandleRing &ring, StHandle handle, RingEntry *sq, "
+               "StHandleCompletion *cq, std::uint32_t entries)\n";
+        out << "{\n";
+        out << "    if (entries == 0 || (entries & (entries - 1)) != 0) {\n";
+        out << "        return STATUS_INVALID_ARGUMENT;\n";
+        out << "    }\n";
+        out << "    ring.handle = handle;\n";
+        out << "    ring.entries = entries;\n";
+        out << "    ring.sqe_size = sizeof(RingEntry);\n";
+        out << "    ring.sq = sq;\n";
+        out << "    ring.cq = cq;\n";
+        out << "    ring.sq_head.store(0, std::memory_order_relaxed);\n";
+        out << "    ring.sq_tail.store(0, std::memory_order_relaxed);\n";
+        out << "    ring.cq_head.store(0, std::memory_order_relaxed);\n";
+        out << "    ring.cq_tail.store(0, std::memory_order_relaxed);\n";
+        out << "    return StHandle_RingAttach(handle, &ring);\n";
+        out << "}\n\n";
+    }
+
+    out << "/* Marshalling */\n";
+    out << "namespace detail {\n\n";
+    out << "template <typename Function>\n";
+    out << "struct Marshal;\n\n";
+    out << buf_marshal.str();
+    out << "}  // namespace detail\n\n";
+
+    out << "/* Handles */\n";
+    out << buf_handles.str();
+
+    out << "}  // namespace " << namespace_name << "\n\n";
+    out << "#endif /* __SIDL_INTERFACE_" << macro_interface_name << "_HPP__ */\n";
+}
+
+void CppHeaderGenerator::visit(GroupNode &node)
+{
+    group_functions.clear();
+
+    buf_handles << "template <std::uint64_t Revision>\n";
+    buf_handles << "class " << node.name << ";\n\n";
+
+    for (const auto &abi : node.abiversions) {
+        abi->accept(*this);
+        emit_handle(node, *abi);
+    }
+}
+
+void CppHeaderGenerator::visit(AbiversionNode &node)
+{
+    for (const auto &b : node.bitfields) {
+        b->accept(*this);
+    }
+
+    for (const auto &e : node.enums) {
+        e->accept(*this);
+    }
+
+    for (const auto &s : node.structs) {
+        s->accept(*this);
+    }
+
+    for (const auto &f : node.functions) {
+        group_functions.push_back(f);
+        f->accept(*this);
+    }
+}
+
+void CppHeaderGenerator::visit(StructNode &node)
+{
+    std::string attributes = "";
+    std::string type_name(node.name);
+
+    // The layout pass has already validated the annotation
+    for (const auto &anno : node.annotations) {
+        if (anno->name == "align_size") {
+            auto align_param = dynamic_cast<NumberLiteralExpressionNode *>(anno->args[0]);
+            attributes += " alignas(" + std::to_string(align_param->value) + ")";
+        }
+    }
+
+    buf_types << "struct" << attributes << " " << node.name << " {\n";
+    for (const auto &field : node.fields) {
+        if (field->type->is_array) {
+            buf_types << "    " << to_c_type(prefix, *field->type) << " " << field->name << "[];\n";
+        } else {
+            buf_types << "    " << value_decl(*field->type, std::string(field->name)) << ";\n";
+        }
+    }
+    buf_types << "};\n";
+
+    for (const auto &field : node.fields) {
+        buf_types << "static_assert(offsetof(" << type_name << ", " << field->name
+                  << ") == " << field->offset << ");\n";
+    }
+    buf_types << "static_assert(sizeof(" << type_name << ") == " << node.size << ");\n";
+    buf_types << "static_assert(alignof(" << type_name << ") == " << node.alignment << ");\n\n";
+}
+
+void CppHeaderGenerator::visit(BitfieldNode &node)
+{
+    uint64_t offset = 0;
+    std::string base = to_c_type(prefix, *node.base_type);
+
+    buf_types << "enum class " << node.name << " : " << base << " {\n";
+    for (const auto &field : node.fields) {
+        buf_types << "    " << field->name << " = " << (((1ULL << field->bits) - 1) << offset)
+                  << "u,\n";
+        offset += field->bits;
+    }
+    buf_types << "};\n";
+
+    for (const char *op : { "|", "&", "^" }) {
+        buf_types << "constexpr " << node.name << " operator" << op << "(" << node.name << " a, "
+                  << node.name << " b)\n";
+        buf_types << "{\n";
+        buf_types << "    return static_cast<" << node.name << ">(static_cast<" << base << ">(a) "
+                  << op << " static_cast<" << base << ">(b));\n";
+        buf_types << "}\n";
+    }
+    buf_types << "constexpr " << node.name << " operator~(" << node.name << " a)\n";
+    buf_types << "{\n";
+    buf_types << "    return static_cast<" << node.name << ">(~static_cast<" << base << ">(a));\n";
+    buf_types << "}\n";
+    buf_types << "static_assert(sizeof(" << node.name << ") == " << node.base_type->type_size
+              << ");\n\n";
+}
+
+void CppHeaderGenerator::visit(EnumNode &node)
+{
+    buf_types << "enum class " << node.name << " : " << to_c_type(prefix, *node.base_type) << " {\n";
+    for (const auto &member : node.members) {
+        buf_types << "    " << member->name << " = " << member->value << ",\n";
+    }
+    buf_types << "};\n";
+    buf_types << "static_assert(sizeof(" << node.name << ") == " << node.base_type->type_size
+              << ");\n\n";
+}
+
+std::string CppHeaderGenerator::word_value(const std::vector<RegField> &word)
+{
+    if (word.size() == 1 && word.front().shift == 0) {
+        return "sidl::word(" + wire_value(*word.front().param) + ")";
+    }
+
+    std::string value;
+    for (const auto &field : word) {
+        std::string part =
+            "sidl::field<" + std::to_string(field.bits) + ">(" + wire_value(*field.param) + ")";
+
+        if (!value.empty()) {
+            value += " | ";
+        }
+        value += field.shift == 0 ? part : "(" + part + " << " + std::to_string(field.shift) + ")";
+    }
+    return "(" + value + ")";
+}
+
+void CppHeaderGenerator::emit_arg_block(
+    FunctionNode &node, const std::string &suffix, std::vector<ParameterNode *> params
+)
+{
+    std::string block_name = std::string(node.name) + "_" + suffix;
+    BlockLayout block = block_layout(params);
+
+    buf_blocks << "struct " << (layout == CBlockLayout::PACKED ? "[[gnu::packed]] " : "")
+               << block_name << " {\n";
+    for (const auto &field : block.fields) {
+        auto param = field.param;
+        if (param->direction == ParameterNode::Direction::OUT) {
+            buf_blocks << "    " << value_decl(*param->type, std::string(param->name)) << ";\n";
+        } else {
+            buf_blocks << "    " << wire_decl(*param, std::string(param->name)) << ";\n";
+        }
+    }
+    buf_blocks << "};\n";
+
+    for (const auto &field : block.fields) {
+        buf_blocks << "static_assert(offsetof(" << block_name << ", " << field.param->name
+                   << ") == " << field.offset << ");\n";
+    }
+    buf_blocks << "static_assert(sizeof(" << block_name << ") == " << block.size << ");\n";
+    buf_blocks << "static_assert(alignof(" << block_name << ") == " << block.alignment << ");\n\n";
+}
+
+void CppHeaderGenerator::visit(FunctionNode &node)
+{
+    CallShape shape = classify(node);
+
+    buf_functions << "struct " << node.name << " {\n";
+    buf_functions << "    static constexpr std::uint32_t group = groups::"
+                  << node.abiversion.group.name << ";\n";
+    buf_functions << "    static constexpr std::uint64_t abirevision = " << node.abiversion.version
+                  << ";\n";
+    buf_functions << "    static constexpr std::uint32_t id = " << node.id << ";\n";
+    buf_functions << "};\n\n";
+
+    if (!shape.use_call_reg) {
+        if (shape.packed_in_params.size() > 1) {
+            emit_arg_block(node, "In", shape.packed_in_params);
+        }
+        if (shape.packed_out_params.size() > 1) {
+            emit_arg_block(node, "Out", shape.packed_out_params);
+        }
+    }
+
+    emit_marshal(node, shape);
+    if (is_async(node)) {
+        has_async = true;
+        emit_submit(node, shape);
+    }
+    buf_marshal << "};\n\n";
+}
+
+void CppHeaderGenerator::emit_marshal(FunctionNode &node, const CallShape &shape)
+{
+    const auto &packed_in_params = shape.packed_in_params;
+    const auto &packed_out_params = shape.packed_out_params;
+    std::stringstream &os = buf_marshal;
+    std::string block_name = "layout::" + std::string(node.name);
+
+    os << "template <>\n";
+    os << "struct Marshal<functions::" << node.name << "> {\n";
+    os << "    static StStatus call(StHandle handle, std::uint32_t funcid";
+    for (const auto &param : node.parameters) {
+        os << ", " << param_decl(*param, "_" + std::string(param->name));
+    }
+    os << ")\n";
+    os << "    {\n";
+
+    bool needs_offsets = std::any_of(node.parameters.begin(), node.parameters.end(), [&](auto &p) {
+        return is_shared(*p);
+    });
+
+    // The plain register path needs no locals at all
+    if (shape.use_call_reg && shape.reg_out_params.empty() && !needs_offsets) {
+        os << "        return sidl::call(handle, funcid";
+        for (const auto &word : shape.reg_words) {
+            os << ", " << word_value(word);
+        }
+        os << ");\n";
+        os << "    }\n";
+        return;
+    }
+
+    // Short payloads are copied into the words right behind the block, one slot per array
+    size_t n_inline = 0;
+    if (!shape.use_call_reg && options.inline_array_max != 0) {
+        for (const auto &param : node.parameters) {
+            if (is_inline_array(*param)) {
+                n_inline++;
+            }
+        }
+    }
+    std::string in = n_inline != 0 ? "block.in" : "in";
+
+    os << "        StStatus status;\n";
+    for (const auto &param : node.parameters) {
+        if (is_shared(*param)) {
+            os << "        std::uint64_t " << wire_value(*param) << ";\n";
+        }
+    }
+    if (!shape.reg_out_params.empty()) {
+        os << "        unsigned long rets[" << shape.reg_out_params.size() << "];\n";
+    }
+    if (n_inline != 0) {
+        has_inline_arrays = true;
+        os << "        struct {\n";
+        os << "            " << block_name << "_In in;\n";
+        os << "            std::uint64_t payload[" << n_inline * options.inline_array_max / 8
+           << "];\n";
+        os << "        } block;\n";
+        os << "        std::size_t payload_size = 0;\n";
+    } else if (!shape.use_call_reg && packed_in_params.size() > 1) {
+        os << "        " << block_name << "_In in;\n";
+    }
+    if (!shape.use_call_reg && !packed_out_params.empty()) {
+        if (packed_out_params.size() > 1) {
+            os << "        " << block_name << "_Out out;\n";
+        } else if (!packed_out_params.front()->type->is_ptr) {
+            os << "        " << to_c_type(prefix, *packed_out_params.front()->type) << " out;\n";
+        }
+    }
+
+    emit_length_checks(node);
+    // Only the offset crosses the boundary; the payload already sits in the shared region.
+    for (const auto &param : node.parameters) {
+        if (is_shared(*param)) {
+            auto length = length_param(node, *param);
+            std::string len = length ? "_" + std::string(length->name) : "";
+
+            os << "        status = StShm_ToOffset(handle, _" << param->name << ", "
+               << shared_extent(node, *param, len) << ", &" << wire_value(*param) << ");\n";
+            os << "        if (!CHECK_SUCCESS(status)) {\n";
+            os << "            return status;\n";
+            os << "        }\n";
+        }
+    }
+    if (!shape.use_call_reg && packed_in_params.size() > 1) {
+        for (const auto &param : packed_in_params) {
+            os << "        " << in << "." << param->name << " = " << wire_value(*param) << ";\n";
+        }
+    }
+    for (const auto &param : node.parameters) {
+        auto length = length_param(node, *param);
+        if (n_inline == 0 || !is_inline_array(*param)) {
+            continue;
+        }
+
+        std::string ptr = "_" + std::string(param->name);
+        std::string len = "_" + std::string(length->name);
+        std::string dest = n_inline > 1 ?
+            "reinterpret_cast<std::uint8_t *>(block.payload) + payload_size" :
+            "block.payload";
+
+        os << "        if (" << len << " != 0 && "
+           << length_fits(*param, ptr, len, std::to_string(options.inline_array_max)) << ") {\n";
+        os << "            std::memcpy(" << dest << ", " << ptr << ", "
+           << length_bytes(*param, ptr, len) << ");\n";
+        os << "            block.in." << param->name << " = nullptr;\n";
+        os << "            payload_size += (" << length_bytes(*param, ptr, len)
+           << " + 7) / 8 * 8;\n";
+        os << "        }\n";
+    }
+
+    if (shape.use_call_reg && !shape.reg_out_params.empty()) {
+        os << "        status = sidl::call_ret(handle, funcid, rets";
+        for (const auto &word : shape.reg_words) {
+            os << ", " << word_value(word);
+        }
+        os << ");\n";
+    } else if (shape.use_call_reg) {
+        os << "        status = sidl::call(handle, funcid";
+        for (const auto &word : shape.reg_words) {
+            os << ", " << word_value(word);
+        }
+        os << ");\n";
+    } else {
+        os << "        status = StHandle_CallN" << (shape.sized_in ? "S" : "")
+           << "(handle, funcid, ";
+        if (shape.sized_in && n_inline != 0) {
+            os << "&" << in << ", (sizeof(block.in) + 7) / 8 * 8 + payload_size, ";
+        } else if (shape.sized_in) {
+            os << "&" << in << ", sizeof(in), ";
+        } else if (packed_in_params.size() > 1) {
+            os << "&" << in << ", ";
+        } else if (packed_in_params.size() == 1 && wire_is_ptr(*packed_in_params.front())) {
+            os << "_" << packed_in_params.front()->name << ", ";
+        } else if (packed_in_params.size() == 1) {
+            os << "&" << wire_value(*packed_in_params.front()) << ", ";
+        } else {
+            os << "nullptr, ";
+        }
+        if (packed_out_params.size() == 1 && packed_out_params.front()->type->is_ptr) {
+            os << "_" << packed_out_params.front()->name << ", ";
+        } else if (!packed_out_params.empty()) {
+            os << "&out, ";
+        } else {
+            os << "nullptr, ";
+        }
+        for (size_t i = 0; i < shape.k_peel; ++i) {
+            os << (i < shape.reg_words.size() ? word_value(shape.reg_words[i]) : "0")
+               << (i < shape.k_peel - 1 ? ", " : "");
+        }
+        os << ");\n";
+    }
+    os << "        if (!CHECK_SUCCESS(status)) {\n";
+    os << "            return status;\n";
+    os << "        }\n";
+
+    for (size_t i = 0; i < shape.reg_out_params.size(); ++i) {
+        auto param = shape.reg_out_params[i];
+        os << "        if (_" << param->name << " != nullptr) {\n";
+        os << "            *_" << param->name << " = sidl::unword<"
+           << to_c_type(prefix, *param->type) << ">(rets[" << i << "]);\n";
+        os << "        }\n";
+    }
+    if (!shape.use_call_reg) {
+        for (const auto &param : packed_out_params) {
+            if (packed_out_params.size() == 1 && param->type->is_ptr) {
+                break;
+            }
+            os << "        if (_" << param->name << " != nullptr) {\n";
+            os << "            *_" << param->name << " = out"
+               << (packed_out_params.size() > 1 ? "." + std::string(param->name) : "") << ";\n";
+            os << "        }\n";
+        }
+    }
+
+    os << "        return STATUS_SUCCESS;\n";
+    os << "    }\n";
+}
+
+void CppHeaderGenerator::emit_length_checks(FunctionNode &node)
+{
+    for (const auto &param : node.parameters) {
+        if (auto length = length_param(node, *param)) {
+            buf_marshal << "        if (_" << param->name << " == nullptr && _" << length->name
+                        << " != 0) {\n";
+            buf_marshal << "            return STATUS_INVALID_ARGUMENT;\n";
+            buf_marshal << "        }\n";
+        }
+    }
+}
+
+void CppHeaderGenerator::emit_submit(FunctionNode &node, const CallShape &shape)
+{
+    const auto &packed_in_params = shape.packed_in_params;
+    const auto &packed_out_params = shape.packed_out_params;
+    std::stringstream &os = buf_marshal;
+    bool has_member = !shape.use_call_reg &&
+        (packed_in_params.size() > 1 ||
+         (packed_in_params.size() == 1 && !wire_is_ptr(*packed_in_params.front())));
+
+    if (has_member && packed_in_params.size() > 1) {
+        buf_ring_members << "        layout::" << node.name << "_In " << node.name << ";\n";
+    } else if (has_member) {
+        buf_ring_members << "        " << wire_decl(*packed_in_params.front(), std::string(node.name))
+                         << ";\n";
+    }
+
+    os << "\n";
+    os << "    static StStatus submit(StHandleRing &ring, std::uint64_t user_data, StHandle handle, "
+          "std::uint32_t funcid";
+    for (const auto &param : node.parameters) {
+        os << ", " << param_decl(*param, "_" + std::string(param->name));
+    }
+    os << ")\n";
+    os << "    {\n";
+    os << "        std::uint32_t tail = ring.sq_tail.load(std::memory_order_relaxed);\n";
+    if (std::any_of(node.parameters.begin(), node.parameters.end(), [&](auto &p) {
+            return is_shared(*p);
+        })) {
+        os << "        StStatus status;\n";
+    }
+    for (const auto &param : node.parameters) {
+        if (is_shared(*param)) {
+            os << "        std::uint64_t " << wire_value(*param) << ";\n";
+        }
+    }
+    if (!packed_out_params.empty() && !packed_out_params.front()->type->is_ptr) {
+        os << "        if (_" << packed_out_params.front()->name << " == nullptr) {\n";
+        os << "            return STATUS_INVALID_ARGUMENT;\n";
+        os << "        }\n";
+    }
+    emit_length_checks(node);
+    os << "        if (tail - ring.sq_head.load(std::memory_order_acquire) == ring.entries) {\n";
+    os << "            return STATUS_BUSY;\n";
+    os << "        }\n";
+    for (const auto &param : node.parameters) {
+        if (is_shared(*param)) {
+            auto length = length_param(node, *param);
+            std::string len = length ? "_" + std::string(length->name) : "";
+
+            os << "        status = StShm_ToOffset(handle, _" << param->name << ", "
+               << shared_extent(node, *param, len) << ", &" << wire_value(*param) << ");\n";
+            os << "        if (!CHECK_SUCCESS(status)) {\n";
+            os << "            return status;\n";
+            os << "        }\n";
+        }
+    }
+    os << "        RingEntry *sqe = &static_cast<RingEntry *>(ring.sq)[tail & (ring.entries - 1)];\n";
+
+    if (has_member && packed_in_params.size() > 1) {
+        for (const auto &param : packed_in_params) {
+            os << "        sqe->in." << node.name << "." << param->name << " = "
+               << wire_value(*param) << ";\n";
+        }
+    } else if (has_member) {
+        os << "        sqe->in." << node.name << " = " << wire_value(*packed_in_params.front())
+           << ";\n";
+    }
+
+    os << "        sqe->desc.handle = handle;\n";
+    os << "        sqe->desc.funcid = funcid;\n";
+    os << "        sqe->desc.in_size = 0;\n";
+    if (has_member) {
+        os << "        sqe->desc.in = &sqe->in." << node.name << ";\n";
+    } else if (!shape.use_call_reg && !packed_in_params.empty()) {
+        os << "        sqe->desc.in = _" << packed_in_params.front()->name << ";\n";
+    } else {
+        os << "        sqe->desc.in = nullptr;\n";
+    }
+    if (!shape.use_call_reg && !packed_out_params.empty()) {
+        os << "        sqe->desc.out = _" << packed_out_params.front()->name << ";\n";
+    } else {
+        os << "        sqe->desc.out = nullptr;\n";
+    }
+    for (size_t i = 0; i < shape.reg_words.size(); ++i) {
+        os << "        sqe->desc.args[" << i << "] = " << word_value(shape.reg_words[i]) << ";\n";
+    }
+    os << "        sqe->desc.user_data = user_data;\n";
+    os << "        sqe->desc.status = STATUS_SUCCESS;\n";
+    os << "        ring.sq_tail.store(tail + 1, std::memory_order_release);\n";
+    os << "        return STATUS_SUCCESS;\n";
+    os << "    }\n";
+}
+
+void CppHeaderGenerator::emit_handle(GroupNode &group, AbiversionNode &abi)
+{
+    std::stringstream &os = buf_handles;
+    std::string name(group.name);
+
+    // A handle resolved for one revision serves every function up to and including it
+    os << "template <>\n";
+    os << "class " << name << "<" << abi.version << "> {\n";
+    os << "  public:\n";
+    os << "    static constexpr std::uint32_t group = groups::" << name << ";\n";
+    os << "    static constexpr std::uint64_t abirevision = " << abi.version << ";\n\n";
+    os << "    constexpr " << name << "() = default;\n";
+    os << "    constexpr " << name << "(StHandle handle, std::uint32_t funcid_base)\n";
+    os << "        : handle_(handle), funcid_base_(funcid_base)\n";
+    os << "    {\n";
+    os << "    }\n\n";
+    os << "    static StStatus resolve(StHandle handle, " << name << " &resolved)\n";
+    os << "    {\n";
+    os << "        std::uint32_t funcid_base;\n";
+    os << "        StStatus status =\n";
+    os << "            StHandle_Query(handle, &uuid, group, abirevision, &funcid_base, nullptr);\n";
+    os << "        if (!CHECK_SUCCESS(status)) {\n";
+    os << "            return status;\n";
+    os << "        }\n";
+    os << "        resolved = " << name << "(handle, funcid_base);\n";
+    os << "        return STATUS_SUCCESS;\n";
+    os << "    }\n\n";
+    os << "    constexpr StHandle handle() const\n";
+    os << "    {\n";
+    os << "        return handle_;\n";
+    os << "    }\n\n";
+    os << "    constexpr std::uint32_t funcid_base() const\n";
+    os << "    {\n";
+    os << "        return funcid_base_;\n";
+    os << "    }\n";
+
+    for (const auto &function : group_functions) {
+        os << "\n";
+        os << "    StStatus " << function->name << "(";
+        for (size_t i = 0; i < function->parameters.size(); ++i) {
+            auto &param = *function->parameters[i];
+            os << (i > 0 ? ", " : "") << param_decl(param, std::string(param.name));
+        }
+        os << ") const\n";
+        os << "    {\n";
+        os << "        return detail::Marshal<functions::" << function->name
+           << ">::call(handle_, funcid_base_ + functions::" << function->name << "::id";
+        for (const auto &param : function->parameters) {
+            os << ", " << param->name;
+        }
+        os << ");\n";
+        os << "    }\n";
+
+        if (!is_async(*function)) {
+            continue;
+        }
+
+        // co_await-able variant, completed through the queue's executor
+        os << "\n";
+        os << "    auto " << function->name << "(const sidl::Queue &queue";
+        for (const auto &param : function->parameters) {
+            os << ", " << param_decl(*param, std::string(param->name));
+        }
+        os << ") const\n";
+        os << "    {\n";
+        os << "        return sidl::Call(queue, [=, handle = handle_, funcid = funcid_base_ + "
+              "functions::"
+           << function->name << "::id](StHandleRing &ring, std::uint64_t user_data) {\n";
+        os << "            return detail::Marshal<functions::" << function->name
+           << ">::submit(ring, user_data, handle, funcid";
+        for (const auto &param : function->parameters) {
+            os << ", " << param->name;
+        }
+        os << ");\n";
+        os << "        });\n";
+        os << "    }\n";
+    }
+
+    os << "\n";
+    os << "  private:\n";
+    os << "    StHandle handle_ = 0;\n";
+    os << "    std::uint32_t funcid_base_ = 0;\n";
+    os << "};\n\n";
+}
@@ -0,0 +1,319 @@
+#include <layout.hh>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <arch_abi.hh>
+#include <ast.hh>
+#include <lang_info.hh>
+
+static size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void LayoutPass::visit(InterfaceNode &node)
+{
+    // Named types may be used before (or in a later abirevision than) they are declared, so every
+    // name is collected up front.
+    for (const auto &group : node.groups) {
+        for (const auto &abi : group->abiversions) {
+            for (const auto &s : abi->structs) {
+                structs[s->name] = s;
+            }
+            for (const auto &e : abi->enums) {
+                aliases[e->name] = e->base_type;
+            }
+            for (const auto &b : abi->bitfields) {
+                aliases[b->name] = b->base_type;
+            }
+        }
+    }
+
+    for (const auto &group : node.groups) {
+        for (const auto &abi : group->abiversions) {
+            abi->accept(*this);
+        }
+    }
+}
+
+void LayoutPass::visit(AbiversionNode &node)
+{
+    for (const auto &b : node.bitfields) {
+        b->accept(*this);
+    }
+
+    for (const auto &e : node.enums) {
+        e->accept(*this);
+    }
+
+    for (const auto &s : node.structs) {
+        s->accept(*this);
+    }
+
+    for (const auto &f : node.functions) {
+        f->accept(*this);
+    }
+}
+
+void LayoutPass::visit(StructNode &node)
+{
+    layout_struct(node);
+}
+
+void LayoutPass::visit(BitfieldNode &node)
+{
+    layout_type(*node.base_type);
+
+    auto &base = *node.base_type;
+    if (base.is_ptr || base.is_array || base.is_struct || base.type_size == 0) {
+        throw std::runtime_error(
+            "Bitfield " + std::string(node.name) + " must have an integer base type"
+        );
+    }
+
+    uint64_t bits = 0;
+    for (const auto &field : node.fields) {
+        bits += field->bits;
+    }
+    if (bits > base.type_size * 8) {
+        throw std::runtime_error("Bitfield " + std::string(node.name) + " overflows its base type");
+    }
+}
+
+void LayoutPass::visit(EnumNode &node)
+{
+    layout_type(*node.base_type);
+
+    auto &base = *node.base_type;
+    if (base.is_ptr || base.is_array || base.is_struct || base.type_size == 0) {
+        throw std::runtime_error("Enum " + std::string(node.name) + " must have an integer base type");
+    }
+}
+
+void LayoutPass::visit(FunctionNode &node)
+{
+    for (const auto &param : node.parameters) {
+        layout_type(*param->type);
+
+        if (param->type->type_alignment == 0) {
+            throw std::runtime_error(
+                "Parameter " + std::string(param->name) + " of " + std::string(node.name) +
+                " cannot be passed by value"
+            );
+        }
+    }
+
+    for (const auto &param : node.parameters) {
+        check_length(node, *param);
+    }
+}
+
+void LayoutPass::check_length(FunctionNode &node, ParameterNode &param)
+{
+    AnnotationNode *length = nullptr;
+    bool shared = false;
+    std::string name(param.name);
+
+    for (const auto &anno : param.annotations) {
+        if (anno->name == "shared") {
+            shared = true;
+        }
+        if (anno->name != "count" && anno->name != "size") {
+            continue;
+        }
+        if (length) {
+            throw std::runtime_error("Parameter " + name + " has more than one length");
+        }
+        length = anno;
+    }
+
+    auto &type = *param.type;
+    if (!length) {
+        if (type.is_array) {
+            throw std::runtime_error("Array parameter " + name + " needs @count or @size");
+        }
+        // Without a length a @shared pointer covers a single pointee, checked against the region
+        if (shared && type.is_ptr && type.inner_type->type_size == 0) {
+            layout_type(*type.inner_type);
+            if (type.inner_type->type_size == 0) {
+                throw std::runtime_error("@shared parameter " + name + " has no size, use @size");
+            }
+        }
+        return;
+    }
+
+    if (length->args.size() != 1) {
+        throw std::runtime_error("Invalid argument size");
+    }
+    auto length_name = dynamic_cast<IdentifierExpressionNode *>(length->args[0]);
+    if (!length_name) {
+        throw std::runtime_error("Invalid argument type");
+    }
+
+    // The payload may be copied into the argument block, so the callee must not write through it;
+    // a @shared payload stays in the region and may be written in place
+    if (!shared && (param.direction != ParameterNode::Direction::IN ||
+                    !(type.is_array || (type.is_ptr && type.is_const)))) {
+        throw std::runtime_error(
+            "@" + std::string(length->name) + " parameter " + name +
+            " must be an in const ptr<> or array<>"
+        );
+    }
+    if (length->name == "count" && type.inner_type->type_size == 0) {
+        layout_type(*type.inner_type);
+        if (type.inner_type->type_size == 0) {
+            throw std::runtime_error("Elements of " + name + " have no size, use @size");
+        }
+    }
+
+    ParameterNode *length_param = nullptr;
+    for (const auto &other : node.parameters) {
+        if (other->name == length_name->name) {
+            length_param = other;
+        }
+    }
+    if (!length_param) {
+        throw std::runtime_error(
+            "Unknown length " + std::string(length_name->name) + " of parameter " + name
+        );
+    }
+
+    auto &length_type = *length_param->type;
+    if (length_param->direction != ParameterNode::Direction::IN || length_type.is_ptr ||
+        length_type.is_array || length_type.is_struct ||
+        length_type.type_size > g_current_arch_abi->pointer_size) {
+        throw std::runtime_error(
+            "Length " + std::string(length_name->name) + " of parameter " + name +
+            " must be an in integer"
+        );
+    }
+
+    // An array argument is passed like in C, as a pointer to its first element
+    if (type.is_array) {
+        type.is_array = false;
+        type.is_ptr = true;
+        type.is_const = true;
+        type.type_size = g_current_arch_abi->pointer_size;
+        type.type_alignment = g_current_arch_abi->pointer_size;
+    }
+}
+
+void LayoutPass::layout_type(TypeNode &type)
+{
+    if (type.is_ptr) {
+        auto &inner = *type.inner_type;
+
+        // Only the pointee's name has to exist; laying it out could recurse into the struct that
+        // contains this pointer.
+        if (inner.is_ptr || inner.is_array || !structs.contains(inner.name)) {
+            layout_type(inner);
+        }
+
+        type.type_size = g_current_arch_abi->pointer_size;
+        type.type_alignment = g_current_arch_abi->pointer_size;
+        return;
+    }
+
+    if (type.is_array) {
+        layout_type(*type.inner_type);
+
+        type.type_size = 0;
+        type.type_alignment = type.inner_type->type_alignment;
+        return;
+    }
+
+    auto it = g_current_lang_info->type_infos.find(std::string(type.name));
+    if (it != g_current_lang_info->type_infos.end()) {
+        type.type_size = it->second.size;
+        type.type_alignment = it->second.alignment;
+        return;
+    }
+
+    auto alias = aliases.find(type.name);
+    if (alias != aliases.end()) {
+        layout_type(*alias->second);
+
+        type.type_size = alias->second->type_size;
+        type.type_alignment = alias->second->type_alignment;
+        return;
+    }
+
+    auto strct = structs.find(type.name);
+    if (strct != structs.end()) {
+        layout_struct(*strct->second);
+
+        type.type_size = strct->second->size;
+        type.type_alignment = strct->second->alignment;
+        type.is_struct = true;
+        return;
+    }
+
+    throw std::runtime_error("Unknown type " + std::string(type.name));
+}
+
+void LayoutPass::layout_struct(StructNode &node)
+{
+    if (node.alignment != 0) {
+        return;
+    }
+
+    if (in_progress.contains(&node)) {
+        throw std::runtime_error("Struct " + std::string(node.name) + " contains itself");
+    }
+    in_progress.insert(&node);
+
+    size_t offset = 0;
+    size_t alignment = 1;
+
+    for (size_t i = 0; i < node.fields.size(); ++i) {
+        auto &field = *node.fields[i];
+
+        layout_type(*field.type);
+
+        if (field.type->type_alignment == 0) {
+            throw std::runtime_error(
+                "Field " + std::string(field.name) + " of " + std::string(node.name) +
+                " cannot be stored by value"
+            );
+        }
+        // Arrays are emitted as flexible array members
+        if (field.type->is_array && i != node.fields.size() - 1) {
+            throw std::runtime_error(
+                "Array field " + std::string(field.name) + " must be the last field of " +
+                std::string(node.name)
+            );
+        }
+
+        offset = align_up(offset, field.type->type_alignment);
+        field.offset = offset;
+        offset += field.type->type_size;
+        alignment = std::max(alignment, field.type->type_alignment);
+    }
+
+    for (const auto &anno : node.annotations) {
+        if (anno->name != "align_size") {
+            continue;
+        }
+
+        if (anno->args.size() != 1) {
+            throw std::runtime_error("Invalid argument size");
+        }
+
+        auto align_param = dynamic_cast<NumberLiteralExpressionNode *>(anno->args[0]);
+        if (!align_param) {
+            throw std::runtime_error("Invalid argument type");
+        }
+        if (align_param->value == 0 || (align_param->value & (align_param->value - 1)) != 0) {
+            throw std::runtime_error("@align_size must be a power of two");
+        }
+
+        alignment = std::max<size_t>(alignment, align_param->value);
+    }
+
+    node.size = align_up(offset, alignment);
+    node.alignment = alignment;
+
+    in_progress.erase(&node);
+}
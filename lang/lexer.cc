@@ -1,6 +1,115 @@
 #include <lexer.hh>
 
-#include <cctype>
+#include <array>
+#include <cstring>
+
+namespace {
+
+enum CharClass : uint8_t {
+    CHAR_SPACE = 1 << 0,
+    CHAR_IDENT_START = 1 << 1,
+    CHAR_IDENT = 1 << 2,
+    CHAR_DIGIT = 1 << 3,
+    CHAR_XDIGIT = 1 << 4,
+    CHAR_BDIGIT = 1 << 5,
+    CHAR_PUNCT = 1 << 6,
+};
+
+// The C locale classes, fixed at compile time; bytes >= 0x80 belong to no class
+constexpr std::array<uint8_t, 256> char_classes = [] {
+    std::array<uint8_t, 256> table{};
+
+    for (unsigned char c : std::string_view(" \t\n\v\f\r")) {
+        table[c] |= CHAR_SPACE;
+    }
+    for (int c = 0; c < 256; ++c) {
+        bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        bool digit = c >= '0' && c <= '9';
+
+        if (alpha || c == '_') {
+            table[c] |= CHAR_IDENT_START | CHAR_IDENT;
+        }
+        if (digit) {
+            table[c] |= CHAR_IDENT | CHAR_DIGIT | CHAR_XDIGIT;
+        }
+        if ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) {
+            table[c] |= CHAR_XDIGIT;
+        }
+        if (c == '0' || c == '1') {
+            table[c] |= CHAR_BDIGIT;
+        }
+    }
+    for (unsigned char c : std::string_view("@{}()[]<>:;,.=")) {
+        table[c] |= CHAR_PUNCT;
+    }
+    return table;
+}();
+
+constexpr bool has_class(char c, uint8_t char_class)
+{
+    return char_classes[static_cast<unsigned char>(c)] & char_class;
+}
+
+struct Keyword {
+    std::string_view text;
+    Token::Type type;
+};
+
+constexpr Keyword keywords[] = {
+    { "interface", Token::TYPE_KWD_INTERFACE },
+    { "group", Token::TYPE_KWD_GROUP },
+    { "abirevision", Token::TYPE_KWD_ABIREVISION },
+    { "struct", Token::TYPE_KWD_STRUCT },
+    { "bitfield", Token::TYPE_KWD_BITFIELD },
+    { "enum", Token::TYPE_KWD_ENUM },
+    { "function", Token::TYPE_KWD_FUNCTION },
+    { "inout", Token::TYPE_KWD_INOUT },
+    { "in", Token::TYPE_KWD_IN },
+    { "out", Token::TYPE_KWD_OUT },
+    { "ptr", Token::TYPE_KWD_PTR },
+    { "array", Token::TYPE_KWD_ARRAY },
+    { "const", Token::TYPE_KWD_CONST },
+};
+
+constexpr size_t keyword_slots = 32;
+
+// Length, first and last character separate every keyword, so one probe and one compare decide
+constexpr size_t keyword_hash(std::string_view text)
+{
+    return (text.size() + static_cast<unsigned char>(text.front()) +
+            2 * static_cast<unsigned char>(text.back())) %
+           keyword_slots;
+}
+
+constexpr std::array<const Keyword *, keyword_slots> keyword_table = [] {
+    std::array<const Keyword *, keyword_slots> table{};
+
+    for (const auto &keyword : keywords) {
+        table[keyword_hash(keyword.text)] = &keyword;
+    }
+    return table;
+}();
+
+constexpr bool keyword_hash_is_perfect()
+{
+    for (const auto &keyword : keywords) {
+        if (keyword_table[keyword_hash(keyword.text)] != &keyword) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(keyword_hash_is_perfect(), "keyword_hash has a collision, adjust it");
+
+Token::Type classify_identifier(std::string_view text)
+{
+    const Keyword *keyword = keyword_table[keyword_hash(text)];
+
+    return keyword && keyword->text == text ? keyword->type : Token::TYPE_IDENTIFIER;
+}
+
+}  // namespace
 
 void Lexer::advance()
 {
@@ -13,28 +122,50 @@ void Lexer::advance()
     pos++;
 }
 
+void Lexer::advance_to(size_t new_pos)
+{
+    const char *begin = source.data() + pos;
+    const char *end = source.data() + new_pos;
+    const char *line_start = nullptr;
+
+    while (const char *nl = static_cast<const char *>(std::memchr(begin, '\n', end - begin))) {
+        current_line++;
+        line_start = nl + 1;
+        begin = line_start;
+    }
+
+    if (line_start) {
+        current_column = 1 + (end - line_start);
+    } else {
+        current_column += new_pos - pos;
+    }
+    pos = new_pos;
+}
+
+size_t Lexer::scan_while(size_t from, uint8_t char_class) const
+{
+    while (from < source.length() && has_class(source[from], char_class)) {
+        from++;
+    }
+    return from;
+}
+
 void Lexer::skip_unmeaningful_string()
 {
     while (pos < source.length()) {
         char c = source[pos];
-        if (std::isspace(c) || c == '\n') {
+        if (has_class(c, CHAR_SPACE)) {
             advance();
         } else if (c == '/') {
             advance();
             if (pos < source.length() && source[pos] == '/') {
-                while (pos < source.length() && source[pos] != '\n') {
-                    advance();
-                }
+                auto nl = static_cast<const char *>(
+                    std::memchr(source.data() + pos, '\n', source.length() - pos)
+                );
+                advance_to(nl ? nl - source.data() : source.length());
             } else if (pos < source.length() && source[pos] == '*') {
-                advance();
-                while (pos < source.length()) {
-                    if (pos + 1 < source.length() && source[pos] == '*' && source[pos + 1] == '/') {
-                        advance();
-                        advance();
-                        break;
-                    }
-                    advance();
-                }
+                size_t end = source.find("*/", pos + 1);
+                advance_to(end == std::string_view::npos ? source.length() : end + 2);
             }
         } else {
             break;
@@ -42,6 +173,15 @@ void Lexer::skip_unmeaningful_string()
     }
 }
 
+Token Lexer::number_token(size_t start, int radix, uint8_t char_class, size_t start_column)
+{
+    size_t end = scan_while(start, char_class);
+
+    advance_to(end);
+    return { Token::TYPE_NUMBER, source.substr(start, end - start), current_line, start_column,
+             radix };
+}
+
 Token Lexer::next_token()
 {
     skip_unmeaningful_string();
@@ -59,127 +199,48 @@ Token Lexer::next_token()
     size_t start_column = current_column;
 
     // identifier or keyword
-    if (std::isalpha(c) || c == '_') {
+    if (has_class(c, CHAR_IDENT_START)) {
         size_t start_pos = pos;
-        while (pos < source.length() && (std::isalnum(source[pos]) || source[pos] == '_')) {
-            advance();
-        }
+        advance_to(scan_while(pos + 1, CHAR_IDENT));
         std::string_view text = source.substr(start_pos, pos - start_pos);
 
-        Token::Type type = Token::TYPE_IDENTIFIER;
-        if (text == "interface") {
-            type = Token::TYPE_KWD_INTERFACE;
-        } else if (text == "group") {
-            type = Token::TYPE_KWD_GROUP;
-        } else if (text == "abirevision") {
-            type = Token::TYPE_KWD_ABIREVISION;
-        } else if (text == "struct") {
-            type = Token::TYPE_KWD_STRUCT;
-        } else if (text == "function") {
-            type = Token::TYPE_KWD_FUNCTION;
-        } else if (text == "enum") {
-            type = Token::TYPE_KWD_ENUM;
-        } else if (text == "inout") {
-            type = Token::TYPE_KWD_INOUT;
-        } else if (text == "in") {
-            type = Token::TYPE_KWD_IN;
-        } else if (text == "out") {
-            type = Token::TYPE_KWD_OUT;
-        } else if (text == "bitfield") {
-            type = Token::TYPE_KWD_BITFIELD;
-        } else if (text == "ptr") {
-            type = Token::TYPE_KWD_PTR;
-        } else if (text == "array") {
-            type = Token::TYPE_KWD_ARRAY;
-        } else if (text == "const") {
-            type = Token::TYPE_KWD_CONST;
-        }
-
-        return {type, text, current_line, start_column};
+        return {classify_identifier(text), text, current_line, start_column};
     }
 
-    if (c == '0') {
-        advance();
-
-        if (pos < source.length() && (source[pos] == 'x' || source[pos] == 'X')) {
-            // hexadecimal
+    if (c == '0' && pos + 1 < source.length()) {
+        char next = source[pos + 1];
+
+        if (next == 'x' || next == 'X') {
+            advance_to(pos + 2);
+            return number_token(pos, 16, CHAR_XDIGIT, start_column);
+        } else if (next == 'b' || next == 'B') {
+            advance_to(pos + 2);
+            return number_token(pos, 2, CHAR_BDIGIT, start_column);
+        } else if (has_class(next, CHAR_DIGIT)) {
+            // Octal; stray 8s and 9s are left for the parser to reject
             advance();
-            size_t start_pos = pos;
-            while (pos < source.length() && std::isxdigit(source[pos])) {
-                advance();
-            }
-            std::string_view text = source.substr(start_pos, pos - start_pos);
-            return {Token::TYPE_NUMBER, text, current_line, start_column};
-        } else if (pos < source.length() && (source[pos] == 'b' || source[pos] == 'B')) {
-            // binary
-            advance();
-            size_t start_pos = pos;
-            while (pos < source.length() && (source[pos] == '0' || source[pos] == '1')) {
-                advance();
-            }
-            std::string_view text = source.substr(start_pos, pos - start_pos);
-            return {Token::TYPE_NUMBER, text, current_line, start_column};
-        } else if (pos < source.length() && std::isdigit(source[pos])) {
-            // octal
-            size_t start_pos = pos;
-            while (pos < source.length() && std::isdigit(source[pos])) {
-                advance();
-            }
-            std::string_view text = source.substr(start_pos, pos - start_pos);
-            return {Token::TYPE_NUMBER, text, current_line, start_column};
-        } else {
-            // 0
-            std::string_view text = source.substr(pos - 1, 1);
-            return {Token::TYPE_NUMBER, text, current_line, start_column};
+            return number_token(pos, 8, CHAR_DIGIT, start_column);
         }
     }
 
-    if (std::isdigit(c)) {
-        size_t start_pos = pos;
-        while (pos < source.length() && std::isdigit(source[pos])) {
-            advance();
-        }
-        std::string_view text = source.substr(start_pos, pos - start_pos);
-        return {Token::TYPE_NUMBER, text, current_line, start_column};
+    if (has_class(c, CHAR_DIGIT)) {
+        return number_token(pos, 10, CHAR_DIGIT, start_column);
     }
 
     if (c == '"') {
         advance();
         size_t start_pos = pos;
-        while (pos < source.length() && source[pos] != '"') {
+        size_t end = source.find('"', pos);
+        advance_to(end == std::string_view::npos ? source.length() : end);
+        std::string_view text = source.substr(start_pos - 1, pos - start_pos + 2);
+        if (pos < source.length()) {
             advance();
         }
-        std::string_view text = source.substr(start_pos - 1, pos - start_pos + 2);
-        advance();
         return {Token::TYPE_STRING, text, current_line, start_column};
     }
 
-    Token::Type token_type = Token::Type(c);
-    size_t op_len = 1;
-    switch (c) {
-    case '@':
-    case '{':
-    case '}':
-    case '(':
-    case ')':
-    case '[':
-    case ']':
-    case '<':
-    case '>':
-    case ':':
-    case ';':
-    case ',':
-    case '.':
-    case '=':
-        advance();
-        break;
-    default:
-        advance();
-        token_type = Token::TYPE_UNKNOWN;
-        break;
-    }
-
-    std::string_view text = source.substr(pos - op_len, op_len);
+    Token::Type token_type = has_class(c, CHAR_PUNCT) ? Token::Type(c) : Token::TYPE_UNKNOWN;
+    advance();
 
-    return {token_type, text, current_line, start_column};
+    return {token_type, source.substr(pos - 1, 1), current_line, start_column};
 }
@@ -0,0 +1,62 @@
+#include <mapped_file.hh>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile()
+{
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+bool MappedFile::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // Empty files cannot be mapped and need no buffer either
+    if (S_ISREG(st.st_mode) && st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+
+    if (S_ISREG(st.st_mode)) {
+        void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            close(fd);
+            mapping = ptr;
+            mapping_size = st.st_size;
+            contents = std::string_view(static_cast<const char *>(ptr), mapping_size);
+            return true;
+        }
+    }
+
+    char chunk[65536];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) != 0) {
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            close(fd);
+            return false;
+        }
+        buffer.append(chunk, n);
+    }
+    close(fd);
+    contents = buffer;
+    return true;
+}
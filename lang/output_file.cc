@@ -0,0 +1,105 @@
+#include <output_file.hh>
+
+#include <cerrno>
+#include <filesystem>
+#include <random>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mapped_file.hh>
+
+namespace fs = std::filesystem;
+
+// Replace what a symlink points to rather than the link itself
+static std::string resolve_target(const std::string &path)
+{
+    std::error_code ec;
+
+    if (fs::is_symlink(path, ec)) {
+        fs::path resolved = fs::weakly_canonical(path, ec);
+        if (!ec) {
+            return resolved.string();
+        }
+    }
+    return path;
+}
+
+static bool has_content(const std::string &path, std::string_view content)
+{
+    struct stat st;
+
+    // Most changed outputs already differ in length, so only same-sized files are read back
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) ||
+        static_cast<size_t>(st.st_size) != content.size()) {
+        return false;
+    }
+
+    MappedFile existing;
+    return existing.open(path) && existing.view() == content;
+}
+
+// One write() for the whole output, looping only if the kernel stops short
+static bool write_all(int fd, std::string_view content)
+{
+    while (!content.empty()) {
+        ssize_t n = write(fd, content.data(), content.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        content.remove_prefix(n);
+    }
+    return true;
+}
+
+static bool replace_file(const std::string &target, std::string_view content)
+{
+    struct stat st;
+    bool exists = stat(target.c_str(), &st) == 0;
+
+    // Devices and pipes, e.g. /dev/stdout, can only be written in place
+    if (exists && !S_ISREG(st.st_mode)) {
+        int fd = open(target.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+        bool ok = fd >= 0 && write_all(fd, content);
+        if (fd >= 0) {
+            ok = close(fd) == 0 && ok;
+        }
+        return ok;
+    }
+
+    std::random_device random;
+    std::string tmp = target + ".tmp" + std::to_string(random());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return false;
+    }
+
+    // A replaced file keeps its permissions, as it did when it was truncated in place
+    bool ok = (!exists || fchmod(fd, st.st_mode & 07777) == 0) && write_all(fd, content);
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), target.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool write_output(const std::string &path, std::string_view content)
+{
+    return replace_file(resolve_target(path), content);
+}
+
+bool write_output_if_changed(const std::string &path, std::string_view content)
+{
+    std::string target = resolve_target(path);
+
+    if (has_content(target, content)) {
+        return true;
+    }
+    return replace_file(target, content);
+}
@@ -1,7 +1,9 @@
 #include <parser.hh>
 
+#include <charconv>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include <arch_abi.hh>
 #include <ast.hh>
@@ -24,19 +26,39 @@ void Parser::consume(Token::Type token_type)
     advance();
 }
 
-std::unique_ptr<InterfaceNode> Parser::parse()
+uint64_t Parser::parse_number()
+{
+    expect(Token::TYPE_NUMBER);
+
+    std::string_view text = current_token.text;
+    uint64_t value = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value,
+                                     current_token.radix);
+    if (text.empty() || ec != std::errc() || end != text.data() + text.size()) {
+        throw std::runtime_error("Invalid number");
+    }
+
+    advance();
+    return value;
+}
+
+InterfaceNode *Parser::parse()
 {
     try {
-        auto node = std::make_unique<InterfaceNode>();
-        auto default_group = std::make_unique<GroupNode>(*node);
+        auto node = arena.make<InterfaceNode>();
+        auto default_group = arena.make<GroupNode>(*node);
+        std::vector<AnnotationNode *> annotations;
+        std::vector<AbiversionNode *> default_abiversions;
+        std::vector<GroupNode *> groups = { default_group };
         default_group->name = "Default";
         default_group->id = node->current_groupid++;
 
         advance();
 
         while (current_token.type == '@') {
-            node->annotations.push_back(parse_annotation());
+            annotations.push_back(parse_annotation());
         }
+        node->annotations = arena.list(annotations);
 
         consume(Token::TYPE_KWD_INTERFACE);
 
@@ -49,12 +71,12 @@ std::unique_ptr<InterfaceNode> Parser::parse()
         while (current_token.type != Token::Type('}')) {
             switch (current_token.type) {
             case Token::TYPE_KWD_ABIREVISION:
-                default_group->abiversions.push_back(parse_abiversion(*default_group));
+                default_abiversions.push_back(parse_abiversion(*default_group));
                 break;
             case Token::TYPE_KWD_GROUP: {
                 auto group = parse_group(*node);
                 group->id = node->current_groupid++;
-                node->groups.push_back(std::move(group));
+                groups.push_back(group);
                 break;
             }
             default:
@@ -64,7 +86,8 @@ std::unique_ptr<InterfaceNode> Parser::parse()
             }
         }
 
-        node->groups.insert(node->groups.begin(), std::move(default_group));
+        default_group->abiversions = arena.list(default_abiversions);
+        node->groups = arena.list(groups);
 
         consume(Token::Type('}'));
 
@@ -76,9 +99,10 @@ std::unique_ptr<InterfaceNode> Parser::parse()
     }
 }
 
-std::unique_ptr<GroupNode> Parser::parse_group(InterfaceNode &interface)
+GroupNode *Parser::parse_group(InterfaceNode &interface)
 {
-    auto node = std::make_unique<GroupNode>(interface);
+    auto node = arena.make<GroupNode>(interface);
+    std::vector<AbiversionNode *> abiversions;
 
     consume(Token::TYPE_KWD_GROUP);
 
@@ -91,7 +115,7 @@ std::unique_ptr<GroupNode> Parser::parse_group(InterfaceNode &interface)
     while (current_token.type != Token::Type('}')) {
         switch (current_token.type) {
         case Token::TYPE_KWD_ABIREVISION:
-            node->abiversions.push_back(parse_abiversion(*node));
+            abiversions.push_back(parse_abiversion(*node));
             break;
         default:
             throw std::runtime_error("Unexpected token type " + std::to_string(current_token.type));
@@ -100,12 +124,14 @@ std::unique_ptr<GroupNode> Parser::parse_group(InterfaceNode &interface)
 
     consume(Token::Type('}'));
 
+    node->abiversions = arena.list(abiversions);
+
     return node;
 }
 
-std::unique_ptr<IdentifierExpressionNode> Parser::parse_identifier_expression()
+IdentifierExpressionNode *Parser::parse_identifier_expression()
 {
-    auto node = std::make_unique<IdentifierExpressionNode>();
+    auto node = arena.make<IdentifierExpressionNode>();
 
     expect(Token::TYPE_IDENTIFIER);
     node->name = current_token.text;
@@ -114,29 +140,29 @@ std::unique_ptr<IdentifierExpressionNode> Parser::parse_identifier_expression()
     return node;
 }
 
-std::unique_ptr<LiteralExpressionNode> Parser::parse_literal_expression()
+LiteralExpressionNode *Parser::parse_literal_expression()
 {
     switch (current_token.type) {
     case Token::TYPE_STRING: {
-        auto str_arg = std::make_unique<StringLiteralExpressionNode>();
+        auto str_arg = arena.make<StringLiteralExpressionNode>();
         str_arg->value = current_token.text;
         advance();
-        return std::move(str_arg);
+        return str_arg;
     }
     case Token::TYPE_NUMBER: {
-        auto num_arg = std::make_unique<NumberLiteralExpressionNode>();
-        num_arg->value = std::stoull(std::string(current_token.text));
-        advance();
-        return std::move(num_arg);
+        auto num_arg = arena.make<NumberLiteralExpressionNode>();
+        num_arg->value = parse_number();
+        return num_arg;
     }
     default:
         throw std::runtime_error("Unexpected token type " + std::to_string(current_token.type));
     }
 }
 
-std::unique_ptr<AnnotationNode> Parser::parse_annotation()
+AnnotationNode *Parser::parse_annotation()
 {
-    auto node = std::make_unique<AnnotationNode>();
+    auto node = arena.make<AnnotationNode>();
+    std::vector<ExpressionNode *> args;
 
     consume(Token::Type('@'));
 
@@ -144,13 +170,18 @@ std::unique_ptr<AnnotationNode> Parser::parse_annotation()
     node->name = current_token.text;
     advance();
 
+    // Annotations without arguments may omit the parentheses
+    if (current_token.type != Token::Type('(')) {
+        return node;
+    }
+
     consume(Token::Type('('));
 
     while (current_token.type != Token::Type(')')) {
         if (current_token.type == Token::TYPE_IDENTIFIER) {
-            node->args.push_back(parse_identifier_expression());
+            args.push_back(parse_identifier_expression());
         } else {
-            node->args.push_back(parse_literal_expression());
+            args.push_back(parse_literal_expression());
         }
 
         if (current_token.type != Token::Type(')')) {
@@ -160,12 +191,14 @@ std::unique_ptr<AnnotationNode> Parser::parse_annotation()
 
     consume(Token::Type(')'));
 
+    node->args = arena.list(args);
+
     return node;
 }
 
-std::unique_ptr<TypeNode> Parser::parse_type()
+TypeNode *Parser::parse_type()
 {
-    auto node = std::make_unique<TypeNode>();
+    auto node = arena.make<TypeNode>();
 
     if (current_token.type == Token::TYPE_KWD_CONST) {
         node->is_const = true;
@@ -203,13 +236,15 @@ std::unique_ptr<TypeNode> Parser::parse_type()
     return node;
 }
 
-std::unique_ptr<ParameterNode> Parser::parse_parameter()
+ParameterNode *Parser::parse_parameter()
 {
-    auto node = std::make_unique<ParameterNode>();
+    auto node = arena.make<ParameterNode>();
+    std::vector<AnnotationNode *> annotations;
 
     while (current_token.type == '@') {
-        node->annotations.push_back(parse_annotation());
+        annotations.push_back(parse_annotation());
     }
+    node->annotations = arena.list(annotations);
 
     switch (current_token.type) {
     case Token::TYPE_KWD_INOUT:
@@ -237,9 +272,10 @@ std::unique_ptr<ParameterNode> Parser::parse_parameter()
     return node;
 }
 
-std::unique_ptr<StructNode> Parser::parse_struct(AbiversionNode &abiversion)
+StructNode *Parser::parse_struct(AbiversionNode &abiversion)
 {
-    auto node = std::make_unique<StructNode>(abiversion);
+    auto node = arena.make<StructNode>(abiversion);
+    std::vector<StructFieldNode *> fields;
 
     consume(Token::TYPE_KWD_STRUCT);
 
@@ -250,7 +286,7 @@ std::unique_ptr<StructNode> Parser::parse_struct(AbiversionNode &abiversion)
     consume(Token::Type('{'));
 
     while (current_token.type != Token::Type('}')) {
-        auto field = std::make_unique<StructFieldNode>();
+        auto field = arena.make<StructFieldNode>();
 
         field->type = parse_type();
 
@@ -258,7 +294,7 @@ std::unique_ptr<StructNode> Parser::parse_struct(AbiversionNode &abiversion)
         field->name = current_token.text;
         advance();
 
-        node->fields.push_back(std::move(field));
+        fields.push_back(field);
 
         consume(Token::Type(';'));
     }
@@ -267,12 +303,15 @@ std::unique_ptr<StructNode> Parser::parse_struct(AbiversionNode &abiversion)
 
     consume(Token::Type(';'));
 
+    node->fields = arena.list(fields);
+
     return node;
 }
 
-std::unique_ptr<BitfieldNode> Parser::parse_bitfield(AbiversionNode &abiversion)
+BitfieldNode *Parser::parse_bitfield(AbiversionNode &abiversion)
 {
-    auto node = std::make_unique<BitfieldNode>(abiversion);
+    auto node = arena.make<BitfieldNode>(abiversion);
+    std::vector<BitfieldFieldNode *> fields;
 
     consume(Token::TYPE_KWD_BITFIELD);
 
@@ -289,7 +328,7 @@ std::unique_ptr<BitfieldNode> Parser::parse_bitfield(AbiversionNode &abiversion)
     consume(Token::Type('{'));
 
     while (current_token.type != Token::Type('}')) {
-        auto field = std::make_unique<BitfieldFieldNode>();
+        auto field = arena.make<BitfieldFieldNode>();
 
         expect(Token::TYPE_IDENTIFIER);
         field->name = current_token.text;
@@ -297,11 +336,9 @@ std::unique_ptr<BitfieldNode> Parser::parse_bitfield(AbiversionNode &abiversion)
 
         consume(Token::Type(':'));
 
-        expect(Token::TYPE_NUMBER);
-        field->bits = std::stoull(std::string(current_token.text));
-        advance();
+        field->bits = parse_number();
 
-        node->fields.push_back(std::move(field));
+        fields.push_back(field);
 
         consume(Token::Type(';'));
     }
@@ -310,13 +347,16 @@ std::unique_ptr<BitfieldNode> Parser::parse_bitfield(AbiversionNode &abiversion)
 
     consume(Token::Type(';'));
 
+    node->fields = arena.list(fields);
+
     return node;
 }
 
-std::unique_ptr<EnumNode> Parser::parse_enum(AbiversionNode &abiversion)
+EnumNode *Parser::parse_enum(AbiversionNode &abiversion)
 {
-    auto node = std::make_unique<EnumNode>(abiversion);
-    auto annotations = std::vector<std::unique_ptr<AnnotationNode>>();
+    auto node = arena.make<EnumNode>(abiversion);
+    std::vector<AnnotationNode *> annotations;
+    std::vector<EnumMemberNode *> members;
 
     consume(Token::TYPE_KWD_ENUM);
 
@@ -333,7 +373,7 @@ std::unique_ptr<EnumNode> Parser::parse_enum(AbiversionNode &abiversion)
     consume(Token::Type('{'));
 
     while (current_token.type != Token::Type('}')) {
-        auto member = std::make_unique<EnumMemberNode>();
+        auto member = arena.make<EnumMemberNode>();
 
         while (current_token.type == '@') {
             annotations.push_back(parse_annotation());
@@ -345,12 +385,11 @@ std::unique_ptr<EnumNode> Parser::parse_enum(AbiversionNode &abiversion)
 
         consume(Token::Type('='));
 
-        expect(Token::TYPE_NUMBER);
-        member->value = std::stoull(std::string(current_token.text));
-        advance();
+        member->value = parse_number();
 
-        member->annotations = std::move(annotations);
-        node->members.push_back(std::move(member));
+        member->annotations = arena.list(annotations);
+        annotations.clear();
+        members.push_back(member);
 
         if (current_token.type != Token::Type('}')) {
             consume(Token::Type(','));
@@ -361,12 +400,15 @@ std::unique_ptr<EnumNode> Parser::parse_enum(AbiversionNode &abiversion)
 
     consume(Token::Type(';'));
 
+    node->members = arena.list(members);
+
     return node;
 }
 
-std::unique_ptr<FunctionNode> Parser::parse_function(AbiversionNode &abiversion)
+FunctionNode *Parser::parse_function(AbiversionNode &abiversion)
 {
-    auto node = std::make_unique<FunctionNode>(abiversion);
+    auto node = arena.make<FunctionNode>(abiversion);
+    std::vector<ParameterNode *> parameters;
 
     consume(Token::TYPE_KWD_FUNCTION);
 
@@ -377,7 +419,7 @@ std::unique_ptr<FunctionNode> Parser::parse_function(AbiversionNode &abiversion)
     consume(Token::Type('('));
 
     while (current_token.type != Token::Type(')')) {
-        node->parameters.push_back(parse_parameter());
+        parameters.push_back(parse_parameter());
 
         if (current_token.type != Token::Type(')')) {
             consume(Token::Type(','));
@@ -387,21 +429,24 @@ std::unique_ptr<FunctionNode> Parser::parse_function(AbiversionNode &abiversion)
     consume(Token::Type(')'));
     consume(Token::Type(';'));
 
+    node->parameters = arena.list(parameters);
     node->id = abiversion.group.current_funcid++;
 
     return node;
 }
 
-std::unique_ptr<AbiversionNode> Parser::parse_abiversion(GroupNode &group)
+AbiversionNode *Parser::parse_abiversion(GroupNode &group)
 {
-    auto node = std::make_unique<AbiversionNode>(group);
-    auto annotations = std::vector<std::unique_ptr<AnnotationNode>>();
+    auto node = arena.make<AbiversionNode>(group);
+    std::vector<AnnotationNode *> annotations;
+    std::vector<FunctionNode *> functions;
+    std::vector<StructNode *> structs;
+    std::vector<BitfieldNode *> bitfields;
+    std::vector<EnumNode *> enums;
 
     consume(Token::TYPE_KWD_ABIREVISION);
 
-    expect(Token::TYPE_NUMBER);
-    node->version = std::stoull(std::string(current_token.text));
-    advance();
+    node->version = parse_number();
 
     consume(Token::Type('{'));
 
@@ -414,26 +459,30 @@ std::unique_ptr<AbiversionNode> Parser::parse_abiversion(GroupNode &group)
         switch (current_token.type) {
         case Token::TYPE_KWD_FUNCTION: {
             auto func = parse_function(*node);
-            func->annotations = std::move(annotations);
-            node->functions.push_back(std::move(func));
+            func->annotations = arena.list(annotations);
+            annotations.clear();
+            functions.push_back(func);
             break;
         }
         case Token::TYPE_KWD_STRUCT: {
             auto strct = parse_struct(*node);
-            strct->annotations = std::move(annotations);
-            node->structs.push_back(std::move(strct));
+            strct->annotations = arena.list(annotations);
+            annotations.clear();
+            structs.push_back(strct);
             break;
         }
         case Token::TYPE_KWD_BITFIELD: {
             auto bitfield = parse_bitfield(*node);
-            bitfield->annotations = std::move(annotations);
-            node->bitfields.push_back(std::move(bitfield));
+            bitfield->annotations = arena.list(annotations);
+            annotations.clear();
+            bitfields.push_back(bitfield);
             break;
         }
         case Token::TYPE_KWD_ENUM: {
             auto enum_node = parse_enum(*node);
-            enum_node->annotations = std::move(annotations);
-            node->enums.push_back(std::move(enum_node));
+            enum_node->annotations = arena.list(annotations);
+            annotations.clear();
+            enums.push_back(enum_node);
             break;
         }
         default:
@@ -443,5 +492,10 @@ std::unique_ptr<AbiversionNode> Parser::parse_abiversion(GroupNode &group)
 
     consume(Token::Type('}'));
 
+    node->functions = arena.list(functions);
+    node->structs = arena.list(structs);
+    node->bitfields = arena.list(bitfields);
+    node->enums = arena.list(enums);
+
     return node;
 }
@@ -0,0 +1,53 @@
+#ifndef __STRATA_EPOLL_EXECUTOR_H__
+#define __STRATA_EPOLL_EXECUTOR_H__
+
+#include <stdint.h>
+
+#include <strata/handle.h>
+#include <strata/macros.h>
+#include <strata/status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Linux stand-in for a Strata completion executor. Every attached ring gets an eventfd that is
+ * signalled whenever completions may have been posted; StEpollExecutor_Poll() waits on all of
+ * them and hands each reaped completion to the executor's callback. Coroutines awaiting a call
+ * are therefore resumed from the polling thread, never from inside the submitting call.
+ */
+
+typedef void (*StEpollCompletionFn)(uint64_t user_data, StStatus status);
+
+struct StEpollExecutor {
+    int epfd;
+    StEpollCompletionFn complete;
+};
+
+struct StEpollRing {
+    struct StEpollExecutor *exec;
+    struct StHandleRing *ring;
+    int efd;
+};
+
+StStatus StEpollExecutor_Create(struct StEpollExecutor *exec __out,
+                                StEpollCompletionFn complete __in);
+void StEpollExecutor_Destroy(struct StEpollExecutor *exec __inout);
+
+/* Waits up to timeout_ms (-1 blocks) and dispatches every completion found */
+StStatus StEpollExecutor_Poll(struct StEpollExecutor *exec __inout, int timeout_ms __in,
+                              uint32_t *completed __out);
+
+StStatus StEpollRing_Attach(struct StEpollRing *ering __out, struct StEpollExecutor *exec __in,
+                            struct StHandleRing *ring __in);
+void StEpollRing_Detach(struct StEpollRing *ering __inout);
+
+/* Submission hook: rings the doorbell for newly queued entries; ctx is the StEpollRing */
+void StEpollRing_Submit(void *ctx __in, struct StHandleRing *ring __inout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STRATA_EPOLL_EXECUTOR_H__ */
@@ -0,0 +1,94 @@
+#ifndef __STRATA_HANDLE_H__
+#define __STRATA_HANDLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+#include <atomic>
+#define ST_ATOMIC(type) std::atomic<type>
+#else
+#define ST_ATOMIC(type) _Atomic type
+#endif
+
+#include <strata/macros.h>
+#include <strata/status.h>
+#include <strata/uuid.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t StHandle;
+
+StStatus StHandle_Query(StHandle handle __in, const struct StUuid *uuid __in, uint32_t group __in,
+                        uint64_t version __in, uint32_t *funcid_base __out, void *reserved __in);
+
+StStatus StHandle_Call0(StHandle handle __in, uint32_t funcid __in);
+StStatus StHandle_Call1(StHandle handle __in, uint32_t funcid __in, unsigned long a0 __in);
+StStatus StHandle_Call2(StHandle handle __in, uint32_t funcid __in, unsigned long a0 __in,
+                        unsigned long a1 __in);
+StStatus StHandle_Call3(StHandle handle __in, uint32_t funcid __in, unsigned long a0 __in,
+                        unsigned long a1 __in, unsigned long a2 __in);
+StStatus StHandle_Call4(StHandle handle __in, uint32_t funcid __in, unsigned long a0 __in,
+                        unsigned long a1 __in, unsigned long a2 __in, unsigned long a3 __in);
+StStatus StHandle_CallN(StHandle handle __in, uint32_t funcid __in, const void *in __in,
+                        void *out __out, unsigned long a0 __in, unsigned long a1 __in);
+/* Like StHandle_CallN, for in blocks followed by a variable payload of in_size bytes in total */
+StStatus StHandle_CallNS(StHandle handle __in, uint32_t funcid __in, const void *in __in,
+                         size_t in_size __in, void *out __out, unsigned long a0 __in);
+
+/* Calls returning up to STHANDLE_CALL_MAX_RETS scalars in registers alongside the status */
+#define STHANDLE_CALL_MAX_RETS 2
+
+StStatus StHandle_CallR0(StHandle handle __in, uint32_t funcid __in, unsigned long *rets __out);
+StStatus StHandle_CallR1(StHandle handle __in, uint32_t funcid __in, unsigned long *rets __out,
+                         unsigned long a0 __in);
+StStatus StHandle_CallR2(StHandle handle __in, uint32_t funcid __in, unsigned long *rets __out,
+                         unsigned long a0 __in, unsigned long a1 __in);
+StStatus StHandle_CallR3(StHandle handle __in, uint32_t funcid __in, unsigned long *rets __out,
+                         unsigned long a0 __in, unsigned long a1 __in, unsigned long a2 __in);
+
+/* Batched calls */
+#define STHANDLE_CALL_MAX_ARGS 4
+
+struct StHandleCallDesc {
+    StHandle handle;
+    uint32_t funcid;
+    const void *in;
+    /* Bytes readable at in; 0 when only the function's fixed in block is */
+    size_t in_size;
+    void *out;
+    unsigned long args[STHANDLE_CALL_MAX_ARGS];
+    uint64_t user_data;
+    StStatus status;
+};
+
+StStatus StHandle_CallBatch(struct StHandleCallDesc *descs __inout, size_t count __in);
+
+/* Asynchronous submission/completion rings */
+struct StHandleCompletion {
+    uint64_t user_data;
+    StStatus status;
+};
+
+struct StHandleRing {
+    StHandle handle;
+    uint32_t entries;
+    uint32_t sqe_size;
+    void *sq;
+    struct StHandleCompletion *cq;
+    ST_ATOMIC(uint32_t) sq_head;
+    ST_ATOMIC(uint32_t) sq_tail;
+    ST_ATOMIC(uint32_t) cq_head;
+    ST_ATOMIC(uint32_t) cq_tail;
+};
+
+StStatus StHandle_RingAttach(StHandle handle __in, struct StHandleRing *ring __inout);
+StStatus StHandle_RingDoorbell(StHandle handle __in, struct StHandleRing *ring __inout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STRATA_HANDLE_H__ */
@@ -0,0 +1,44 @@
+#ifndef __STRATA_LOOPBACK_H__
+#define __STRATA_LOOPBACK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <strata/handle.h>
+#include <strata/macros.h>
+#include <strata/status.h>
+#include <strata/uuid.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * In-process loopback transport. Servers registered here get a handle whose calls are routed
+ * straight into the generated <prefix>Dispatch() on the calling thread, so the whole
+ * client -> dispatch -> handler path can be run and measured without the Strata kernel.
+ */
+
+typedef StStatus (*StLoopbackDispatchFn)(void *server, uint32_t group, uint64_t version,
+                                         struct StHandleCallDesc *desc);
+
+/* A (group, abirevision) the registered server implements */
+struct StLoopbackAbi {
+    uint32_t group;
+    uint64_t version;
+};
+
+/*
+ * abis lists every (group, abirevision) dispatch accepts; StHandle_Query() on the returned handle
+ * fails with STATUS_NOT_SUPPORTED for anything else.
+ */
+StStatus StLoopback_Register(const struct StUuid *uuid __in, const struct StLoopbackAbi *abis __in,
+                             size_t abi_count __in, StLoopbackDispatchFn dispatch __in,
+                             void *server __in, StHandle *handle __out);
+void StLoopback_Unregister(StHandle handle __in);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STRATA_LOOPBACK_H__ */
@@ -0,0 +1,21 @@
+#ifndef __STRATA_MACROS_H__
+#define __STRATA_MACROS_H__
+
+#define __packed __attribute__((packed))
+
+#endif /* __STRATA_MACROS_H__ */
+
+/*
+ * Parameter direction markers are documentation only. libstdc++ uses the same names internally,
+ * so C++ code can scope them to the Strata headers with push_macro/pop_macro; they are therefore
+ * (re)defined on every inclusion.
+ */
+#ifndef __in
+#define __in
+#endif
+#ifndef __out
+#define __out
+#endif
+#ifndef __inout
+#define __inout
+#endif
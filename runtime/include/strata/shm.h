@@ -0,0 +1,46 @@
+#ifndef __STRATA_SHM_H__
+#define __STRATA_SHM_H__
+
+#include <stdint.h>
+
+#include <strata/handle.h>
+#include <strata/macros.h>
+#include <strata/status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Shared bulk transfer regions. A region registered for a handle lets @shared parameters of calls
+ * on that handle travel as offsets into the region instead of raw pointers, so both sides access
+ * the payload in place.
+ */
+
+/* Offset used for NULL pointers */
+#define STSHM_NULL_OFFSET UINT64_MAX
+
+struct StShmRegion {
+    void *base;
+    uint64_t size;
+    int fd;
+};
+
+StStatus StShm_Create(struct StShmRegion *region __out, uint64_t size __in);
+StStatus StShm_Import(struct StShmRegion *region __out, int fd __in);
+void StShm_Destroy(struct StShmRegion *region __inout);
+
+StStatus StShm_Register(StHandle handle __in, const struct StShmRegion *region __in);
+void StShm_Unregister(StHandle handle __in);
+
+/* Both fail unless all count objects of size bytes at ptr lie inside the handle's region */
+StStatus StShm_ToOffset(StHandle handle __in, const void *ptr __in, uint64_t count __in,
+                        uint64_t size __in, uint64_t *offset __out);
+StStatus StShm_FromOffset(StHandle handle __in, uint64_t offset __in, uint64_t count __in,
+                          uint64_t size __in, void **ptr __out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STRATA_SHM_H__ */
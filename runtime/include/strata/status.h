@@ -0,0 +1,21 @@
+#ifndef __STRATA_STATUS_H__
+#define __STRATA_STATUS_H__
+
+/*
+ * Stand-in for the Strata status definitions, just enough to build and run the generated stubs
+ * on a hosted Linux system.
+ */
+
+typedef int StStatus;
+
+#define STATUS_SUCCESS (0)
+#define STATUS_NOT_SUPPORTED (-1)
+#define STATUS_INVALID_ARGUMENT (-2)
+#define STATUS_NO_MEMORY (-3)
+#define STATUS_BUSY (-4)
+#define STATUS_NOT_FOUND (-5)
+#define STATUS_IO_ERROR (-6)
+
+#define CHECK_SUCCESS(status) ((status) >= 0)
+
+#endif /* __STRATA_STATUS_H__ */
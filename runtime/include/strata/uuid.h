@@ -0,0 +1,13 @@
+#ifndef __STRATA_UUID_H__
+#define __STRATA_UUID_H__
+
+#include <stdint.h>
+
+struct StUuid {
+    uint8_t bytes[16];
+};
+
+#define UUID_INIT(...) { { __VA_ARGS__ } }
+#define UUID(...) ((struct StUuid)UUID_INIT(__VA_ARGS__))
+
+#endif /* __STRATA_UUID_H__ */
@@ -0,0 +1,304 @@
+#include <strata/loopback.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Linux stand-in for the Strata handle calls. Every call is dispatched synchronously on the
+ * calling thread. Function ID bases encode which (group, abirevision) the caller resolved, so the
+ * dispatcher can be handed the relative function ID it expects.
+ */
+
+#define LOOPBACK_TABLE_SIZE 256
+#define LOOPBACK_MAX_ABIS 16
+#define LOOPBACK_FUNCID_SHIFT 16
+#define LOOPBACK_FUNCID_MASK ((1u << LOOPBACK_FUNCID_SHIFT) - 1)
+
+struct LoopbackEntry {
+    int used;
+    struct StUuid uuid;
+    StLoopbackDispatchFn dispatch;
+    void *server;
+    struct StLoopbackAbi abis[LOOPBACK_MAX_ABIS];
+    uint32_t abi_count;
+};
+
+static struct LoopbackEntry loopback_table[LOOPBACK_TABLE_SIZE];
+static pthread_rwlock_t loopback_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/* Handle 0 is never handed out, so zero-initialised handles stay invalid */
+static struct LoopbackEntry *loopback_find(StHandle handle)
+{
+    struct LoopbackEntry *entry;
+
+    if (handle == 0 || handle > LOOPBACK_TABLE_SIZE) {
+        return NULL;
+    }
+
+    entry = &loopback_table[handle - 1];
+    return entry->used ? entry : NULL;
+}
+
+static int loopback_find_abi(const struct LoopbackEntry *entry, uint32_t group, uint64_t version,
+                             uint32_t *slot)
+{
+    uint32_t i;
+
+    for (i = 0; i < entry->abi_count; i++) {
+        if (entry->abis[i].group == group && entry->abis[i].version == version) {
+            *slot = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static StStatus loopback_dispatch(const struct StHandleCallDesc *desc)
+{
+    struct StHandleCallDesc call = *desc;
+    const struct LoopbackEntry *entry;
+    uint32_t slot = desc->funcid >> LOOPBACK_FUNCID_SHIFT;
+    StLoopbackDispatchFn dispatch = NULL;
+    void *server = NULL;
+    struct StLoopbackAbi abi = { 0, 0 };
+    StStatus status = STATUS_NOT_FOUND;
+
+    pthread_rwlock_rdlock(&loopback_lock);
+
+    entry = loopback_find(desc->handle);
+    if (entry != NULL && slot >= entry->abi_count) {
+        status = STATUS_INVALID_ARGUMENT;
+    } else if (entry != NULL) {
+        dispatch = entry->dispatch;
+        server = entry->server;
+        abi = entry->abis[slot];
+    }
+
+    pthread_rwlock_unlock(&loopback_lock);
+
+    /* Handlers run unlocked so they can make calls of their own */
+    if (dispatch == NULL) {
+        return status;
+    }
+
+    call.funcid &= LOOPBACK_FUNCID_MASK;
+    return dispatch(server, abi.group, abi.version, &call);
+}
+
+static StStatus loopback_call(StHandle handle, uint32_t funcid, const void *in, size_t in_size,
+                              void *out, unsigned long a0, unsigned long a1, unsigned long a2,
+                              unsigned long a3)
+{
+    struct StHandleCallDesc desc = {
+        .handle = handle,
+        .funcid = funcid,
+        .in = in,
+        .in_size = in_size,
+        .out = out,
+        .args = { a0, a1, a2, a3 },
+        .user_data = 0,
+        .status = STATUS_SUCCESS,
+    };
+
+    return loopback_dispatch(&desc);
+}
+
+StStatus StLoopback_Register(const struct StUuid *uuid __in, const struct StLoopbackAbi *abis __in,
+                             size_t abi_count __in, StLoopbackDispatchFn dispatch __in,
+                             void *server __in, StHandle *handle __out)
+{
+    size_t i;
+    StStatus status = STATUS_NO_MEMORY;
+
+    if (dispatch == NULL || (abis == NULL && abi_count != 0)) {
+        return STATUS_INVALID_ARGUMENT;
+    }
+    if (abi_count > LOOPBACK_MAX_ABIS) {
+        return STATUS_NO_MEMORY;
+    }
+
+    pthread_rwlock_wrlock(&loopback_lock);
+
+    for (i = 0; i < LOOPBACK_TABLE_SIZE; i++) {
+        struct LoopbackEntry *entry = &loopback_table[i];
+
+        if (!entry->used) {
+            entry->used = 1;
+            entry->uuid = *uuid;
+            entry->dispatch = dispatch;
+            entry->server = server;
+            if (abi_count != 0) {
+                memcpy(entry->abis, abis, abi_count * sizeof(*abis));
+            }
+            entry->abi_count = (uint32_t)abi_count;
+            *handle = (StHandle)(i + 1);
+            status = STATUS_SUCCESS;
+            break;
+        }
+    }
+
+    pthread_rwlock_unlock(&loopback_lock);
+    return status;
+}
+
+void StLoopback_Unregister(StHandle handle __in)
+{
+    struct LoopbackEntry *entry;
+
+    pthread_rwlock_wrlock(&loopback_lock);
+
+    entry = loopback_find(handle);
+    if (entry != NULL) {
+        entry->used = 0;
+    }
+
+    pthread_rwlock_unlock(&loopback_lock);
+}
+
+StStatus StHandle_Query(StHandle handle __in, const struct StUuid *uuid __in, uint32_t group __in,
+                        uint64_t version __in, uint32_t *funcid_base __out, void *reserved __in)
+{
+    struct LoopbackEntry *entry;
+    uint32_t slot;
+    StStatus status = STATUS_NOT_FOUND;
+
+    (void)reserved;
+
+    pthread_rwlock_rdlock(&loopback_lock);
+
+    /* The funcid base is the index of the (group, abirevision) in the registered list */
+    entry = loopback_find(handle);
+    if (entry != NULL && memcmp(&entry->uuid, uuid, sizeof(*uuid)) == 0) {
+        if (loopback_find_abi(entry, group, version, &slot)) {
+            *funcid_base = slot << LOOPBACK_FUNCID_SHIFT;
+            status = STATUS_SUCCESS;
+        } else {
+            status = STATUS_NOT_SUPPORTED;
+        }
+    }
+
+    pthread_rwlock_unlock(&loopback_lock);
+    return status;
+}
+
+StStatus StHandle_Call0(StHandle handle __in, uint32_t funcid __in)
+{
+    return loopback_call(handle, funcid, NULL, 0, NULL, 0, 0, 0, 0);
+}
+
+StStatus StHandle_Call1(StHandle handle __in, uint32_t funcid __in, unsigned long a0 __in)
+{
+    return loopback_call(handle, funcid, NULL, 0, NULL, a0, 0, 0, 0);
+}
+
+StStatus StHandle_Call2(StHandle handle __in, uint32_t funcid __in, unsigned long a0 __in,
+                        unsigned long a1 __in)
+{
+    return loopback_call(handle, funcid, NULL, 0, NULL, a0, a1, 0, 0);
+}
+
+StStatus StHandle_Call3(StHandle handle __in, uint32_t funcid __in, unsigned long a0 __in,
+                        unsigned long a1 __in, unsigned long a2 __in)
+{
+    return loopback_call(handle, funcid, NULL, 0, NULL, a0, a1, a2, 0);
+}
+
+StStatus StHandle_Call4(StHandle handle __in, uint32_t funcid __in, unsigned long a0 __in,
+                        unsigned long a1 __in, unsigned long a2 __in, unsigned long a3 __in)
+{
+    return loopback_call(handle, funcid, NULL, 0, NULL, a0, a1, a2, a3);
+}
+
+StStatus StHandle_CallN(StHandle handle __in, uint32_t funcid __in, const void *in __in,
+                        void *out __out, unsigned long a0 __in, unsigned long a1 __in)
+{
+    return loopback_call(handle, funcid, in, 0, out, a0, a1, 0, 0);
+}
+
+StStatus StHandle_CallNS(StHandle handle __in, uint32_t funcid __in, const void *in __in,
+                         size_t in_size __in, void *out __out, unsigned long a0 __in)
+{
+    return loopback_call(handle, funcid, in, in_size, out, a0, 0, 0, 0);
+}
+
+StStatus StHandle_CallR0(StHandle handle __in, uint32_t funcid __in, unsigned long *rets __out)
+{
+    return loopback_call(handle, funcid, NULL, 0, rets, 0, 0, 0, 0);
+}
+
+StStatus StHandle_CallR1(StHandle handle __in, uint32_t funcid __in, unsigned long *rets __out,
+                         unsigned long a0 __in)
+{
+    return loopback_call(handle, funcid, NULL, 0, rets, a0, 0, 0, 0);
+}
+
+StStatus StHandle_CallR2(StHandle handle __in, uint32_t funcid __in, unsigned long *rets __out,
+                         unsigned long a0 __in, unsigned long a1 __in)
+{
+    return loopback_call(handle, funcid, NULL, 0, rets, a0, a1, 0, 0);
+}
+
+StStatus StHandle_CallR3(StHandle handle __in, uint32_t funcid __in, unsigned long *rets __out,
+                         unsigned long a0 __in, unsigned long a1 __in, unsigned long a2 __in)
+{
+    return loopback_call(handle, funcid, NULL, 0, rets, a0, a1, a2, 0);
+}
+
+StStatus StHandle_CallBatch(struct StHandleCallDesc *descs __inout, size_t count __in)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        descs[i].status = loopback_dispatch(&descs[i]);
+    }
+    return STATUS_SUCCESS;
+}
+
+StStatus StHandle_RingAttach(StHandle handle __in, struct StHandleRing *ring __inout)
+{
+    StStatus status = STATUS_NOT_FOUND;
+
+    if (ring->entries == 0 || (ring->entries & (ring->entries - 1)) != 0 ||
+        ring->sqe_size < sizeof(struct StHandleCallDesc)) {
+        return STATUS_INVALID_ARGUMENT;
+    }
+
+    pthread_rwlock_rdlock(&loopback_lock);
+    if (loopback_find(handle) != NULL) {
+        status = STATUS_SUCCESS;
+    }
+    pthread_rwlock_unlock(&loopback_lock);
+
+    return status;
+}
+
+StStatus StHandle_RingDoorbell(StHandle handle __in, struct StHandleRing *ring __inout)
+{
+    uint32_t mask = ring->entries - 1;
+    uint32_t head = atomic_load_explicit(&ring->sq_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->sq_tail, memory_order_acquire);
+    uint32_t cq_tail = atomic_load_explicit(&ring->cq_tail, memory_order_relaxed);
+
+    if (handle != ring->handle) {
+        return STATUS_INVALID_ARGUMENT;
+    }
+
+    /* Entries that do not fit in the completion queue are left for the next doorbell */
+    while (head != tail &&
+           cq_tail - atomic_load_explicit(&ring->cq_head, memory_order_acquire) < ring->entries) {
+        const struct StHandleCallDesc *desc =
+            (const struct StHandleCallDesc *)((uint8_t *)ring->sq + (size_t)(head & mask) *
+                                                                        ring->sqe_size);
+        struct StHandleCompletion *cqe = &ring->cq[cq_tail & mask];
+
+        cqe->status = loopback_dispatch(desc);
+        cqe->user_data = desc->user_data;
+
+        atomic_store_explicit(&ring->cq_tail, ++cq_tail, memory_order_release);
+        atomic_store_explicit(&ring->sq_head, ++head, memory_order_release);
+    }
+
+    return STATUS_SUCCESS;
+}
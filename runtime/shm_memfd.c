@@ -0,0 +1,248 @@
+#define _GNU_SOURCE
+
+#include <strata/shm.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Linux stand-in for shared bulk transfer regions. Regions are memfd-backed so the descriptor can
+ * be passed to another process, which maps the same pages with StShm_Import().
+ */
+
+#define SHM_TABLE_SIZE 64
+
+enum ShmSlotState {
+    SHM_SLOT_EMPTY = 0,
+    SHM_SLOT_USED,
+    SHM_SLOT_DELETED,
+};
+
+/*
+ * Bindings are read on every call with @shared parameters, so lookups never lock: each slot is a
+ * seqlock whose sequence is odd while a writer updates it, and readers retry until they see the
+ * same even sequence before and after copying the fields.
+ */
+struct ShmBinding {
+    _Atomic uint32_t seq;
+    _Atomic int state;
+    _Atomic StHandle handle;
+    _Atomic uintptr_t base;
+    _Atomic uint64_t size;
+};
+
+struct ShmView {
+    int state;
+    StHandle handle;
+    uintptr_t base;
+    uint64_t size;
+};
+
+static struct ShmBinding shm_table[SHM_TABLE_SIZE];
+/* Serialises writers only */
+static pthread_mutex_t shm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void shm_read(const struct ShmBinding *slot, struct ShmView *view)
+{
+    uint32_t seq;
+
+    do {
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        view->state = atomic_load_explicit(&slot->state, memory_order_relaxed);
+        view->handle = atomic_load_explicit(&slot->handle, memory_order_relaxed);
+        view->base = atomic_load_explicit(&slot->base, memory_order_relaxed);
+        view->size = atomic_load_explicit(&slot->size, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) != 0 || atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq);
+}
+
+/* Called with shm_lock held */
+static void shm_write(struct ShmBinding *slot, int state, StHandle handle, uintptr_t base,
+                      uint64_t size)
+{
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->state, state, memory_order_relaxed);
+    atomic_store_explicit(&slot->handle, handle, memory_order_relaxed);
+    atomic_store_explicit(&slot->base, base, memory_order_relaxed);
+    atomic_store_explicit(&slot->size, size, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+}
+
+static struct ShmBinding *shm_find(StHandle handle, struct ShmView *view)
+{
+    size_t i;
+
+    for (i = 0; i < SHM_TABLE_SIZE; i++) {
+        struct ShmBinding *slot = &shm_table[(handle + i) % SHM_TABLE_SIZE];
+
+        shm_read(slot, view);
+        if (view->state == SHM_SLOT_EMPTY) {
+            return NULL;
+        }
+        if (view->state == SHM_SLOT_USED && view->handle == handle) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/* Whether count objects of size bytes at offset fit in a region of region_size bytes */
+static int shm_fits(uint64_t region_size, uint64_t offset, uint64_t count, uint64_t size)
+{
+    if (offset > region_size) {
+        return 0;
+    }
+    return size == 0 || count <= (region_size - offset) / size;
+}
+
+StStatus StShm_Create(struct StShmRegion *region __out, uint64_t size __in)
+{
+    int fd;
+    void *base;
+
+    if (size == 0) {
+        return STATUS_INVALID_ARGUMENT;
+    }
+
+    fd = memfd_create("sidl-shm", MFD_CLOEXEC);
+    if (fd < 0) {
+        return STATUS_NO_MEMORY;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return STATUS_NO_MEMORY;
+    }
+
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return STATUS_NO_MEMORY;
+    }
+
+    region->base = base;
+    region->size = size;
+    region->fd = fd;
+    return STATUS_SUCCESS;
+}
+
+StStatus StShm_Import(struct StShmRegion *region __out, int fd __in)
+{
+    struct stat st;
+    void *base;
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        return STATUS_INVALID_ARGUMENT;
+    }
+
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        return STATUS_NO_MEMORY;
+    }
+
+    region->base = base;
+    region->size = (uint64_t)st.st_size;
+    region->fd = fd;
+    return STATUS_SUCCESS;
+}
+
+void StShm_Destroy(struct StShmRegion *region __inout)
+{
+    if (region->base != NULL) {
+        munmap(region->base, region->size);
+    }
+    if (region->fd >= 0) {
+        close(region->fd);
+    }
+    region->base = NULL;
+    region->size = 0;
+    region->fd = -1;
+}
+
+StStatus StShm_Register(StHandle handle __in, const struct StShmRegion *region __in)
+{
+    struct ShmBinding *slot;
+    struct ShmView view;
+    size_t i;
+    StStatus status = STATUS_NO_MEMORY;
+
+    pthread_mutex_lock(&shm_lock);
+
+    slot = shm_find(handle, &view);
+    if (slot == NULL) {
+        for (i = 0; i < SHM_TABLE_SIZE; i++) {
+            slot = &shm_table[(handle + i) % SHM_TABLE_SIZE];
+            if (atomic_load_explicit(&slot->state, memory_order_relaxed) != SHM_SLOT_USED) {
+                break;
+            }
+            slot = NULL;
+        }
+    }
+
+    if (slot != NULL) {
+        shm_write(slot, SHM_SLOT_USED, handle, (uintptr_t)region->base, region->size);
+        status = STATUS_SUCCESS;
+    }
+
+    pthread_mutex_unlock(&shm_lock);
+    return status;
+}
+
+void StShm_Unregister(StHandle handle __in)
+{
+    struct ShmBinding *slot;
+    struct ShmView view;
+
+    pthread_mutex_lock(&shm_lock);
+
+    slot = shm_find(handle, &view);
+    if (slot != NULL) {
+        shm_write(slot, SHM_SLOT_DELETED, 0, 0, 0);
+    }
+
+    pthread_mutex_unlock(&shm_lock);
+}
+
+StStatus StShm_ToOffset(StHandle handle __in, const void *ptr __in, uint64_t count __in,
+                        uint64_t size __in, uint64_t *offset __out)
+{
+    struct ShmView view;
+    uintptr_t addr = (uintptr_t)ptr;
+
+    if (ptr == NULL) {
+        *offset = STSHM_NULL_OFFSET;
+        return STATUS_SUCCESS;
+    }
+
+    if (shm_find(handle, &view) == NULL || addr < view.base ||
+        !shm_fits(view.size, addr - view.base, count, size)) {
+        return STATUS_INVALID_ARGUMENT;
+    }
+
+    *offset = addr - view.base;
+    return STATUS_SUCCESS;
+}
+
+StStatus StShm_FromOffset(StHandle handle __in, uint64_t offset __in, uint64_t count __in,
+                          uint64_t size __in, void **ptr __out)
+{
+    struct ShmView view;
+
+    if (offset == STSHM_NULL_OFFSET) {
+        *ptr = NULL;
+        return STATUS_SUCCESS;
+    }
+
+    if (shm_find(handle, &view) == NULL || !shm_fits(view.size, offset, count, size)) {
+        return STATUS_INVALID_ARGUMENT;
+    }
+
+    *ptr = (void *)(view.base + offset);
+    return STATUS_SUCCESS;
+}